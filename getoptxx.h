@@ -2,11 +2,50 @@
 #define GUARD_GETOPTXX_H
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <experimental/string_view>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
+// facilities that need threads or the operating system are only compiled
+// when asked for, so other programs do not pay for their headers
+
+#if defined(GETOPTXX_WITH_FILES)
+#include <cstdio>
+#include <future>
+#define GETOPTXX_HAVE_FILES 1
+#endif
+
+#if defined(GETOPTXX_WITH_PATHS) && (defined(__unix__) || defined(__APPLE__))
+#include <condition_variable>
+#include <deque>
+#include <dirent.h>
+#include <exception>
+#include <fnmatch.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#define GETOPTXX_HAVE_PATHS 1
+#endif
+
+#if defined(GETOPTXX_WITH_EARLY) && defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#define GETOPTXX_HAVE_EARLY 1
+#endif
+
 /*!
  * \mainpage
 Basic command line argument parser for C++14 and up.
@@ -16,14 +55,22 @@ specify options for parsing on the command line. The library attempts to
 simplify the boilerplate from `getopt(3)` while using as little overhead as
 possible.
 
-Some memory allocation does occur, since the arguments object uses an
-`unordered_map` and `vector` for storage. All strings, however, use
+Some memory allocation does occur, since the arguments object uses a flat
+hash table and a `vector` for storage. All strings, however, use
 `string_view` so there are no string allocations unless an error occurs.
 Currently the library throws an exception on error.
 
+Facilities that need threads or the operating system are only compiled when
+a macro is defined before the header is included: `GETOPTXX_WITH_FILES` for
+getoptxx::v1::load_file, `GETOPTXX_WITH_PATHS` for getoptxx::v1::check_paths
+and getoptxx::v1::expand_glob on POSIX systems, and `GETOPTXX_WITH_EARLY`
+for getoptxx::v1::early_find on Linux.
+
 The main entry point is getoptxx::v1::arguments::parse which takes a list
 of getoptxx::v1::option values and parses the argc/argv command line
-arguments. A basic example looks like the following:
+arguments. Programs that parse more than once can compile the options into a
+getoptxx::v1::schema and pass that instead. A basic example looks like the
+following:
 
 \code
 #include "getoptxx.h"
@@ -117,6 +164,89 @@ namespace getoptxx {
 inline namespace v1 {
 
 struct option;
+class schema;
+class parser;
+template <std::size_t N> class command_line;
+
+/*!
+ * \brief Resource limits for parsing untrusted command lines.
+ *
+ * Parsing stops with an error as soon as a limit is exceeded, so the work
+ * and memory spent on any input are bounded by the limits rather than by
+ * the size of the input.
+ */
+struct limits final {
+    std::size_t tokens{ SIZE_MAX }; /*!< Maximum number of tokens. */
+    std::size_t bytes{ SIZE_MAX };  /*!< Maximum number of input bytes. */
+};
+
+/*!
+ * \brief An option name whose hash is computed at compile time.
+ *
+ * Looking up a parsed argument by an option_key skips hashing the name:
+ * \code
+ * using namespace getoptxx::literals;
+ * if (args.exists("port"_opt)) port = args["port"_opt];
+ * \endcode
+ */
+class option_key final {
+public:
+    /*!
+     * \brief Create a new option key.
+     * \param[in] str The option name.
+     * \param[in] size The size of the option name.
+     */
+    constexpr option_key(char const* str, std::size_t size) noexcept(true)
+    : m_name{ str, size }, m_hash{ hash(str, size) } {}
+
+    /*!
+     * \brief Hash an option name.
+     * \param[in] str The option name.
+     * \param[in] size The size of the option name.
+     * \return the 64-bit FNV-1a hash of the name.
+     */
+    static constexpr auto hash(char const* str, std::size_t size)
+        noexcept(true) -> std::uint64_t {
+        std::uint64_t h = 0xcbf29ce484222325ull;
+        for (std::size_t i = 0; i<size; ++i) {
+            h = (h^static_cast<unsigned char>(str[i]))*0x100000001b3ull;
+        }
+        return h;
+    }
+
+    /*!
+     * \brief Get the option name.
+     * \return the option name.
+     */
+    constexpr auto name() const noexcept(true) { return m_name; }
+
+    /*!
+     * \brief Get the hash of the option name.
+     * \return the hash of the option name.
+     */
+    constexpr auto hash() const noexcept(true) { return m_hash; }
+
+private:
+    std::experimental::string_view m_name;
+    std::uint64_t m_hash;
+};
+
+/*! \brief User-defined literals for getoptxx. */
+namespace literals {
+
+/*!
+ * \brief Create an option_key from a string literal, hashing it at compile
+ * time.
+ * \param[in] str The option name.
+ * \param[in] size The size of the option name.
+ * \return The getoptxx::v1::option_key
+ */
+constexpr auto operator"" _opt(char const* str, std::size_t size)
+    noexcept(true) -> option_key {
+    return { str, size };
+}
+
+} // namespace literals
 
 /*! \brief Holds the parsed and unparsed arguments. */
 class arguments final {
@@ -134,6 +264,165 @@ public:
     static auto parse(int argc, char* const argv[],
                       std::initializer_list<option> options) -> arguments;
 
+    /*!
+     * \brief Parse the argc/argv command line arguments reusing the storage
+     * of a previously parsed getoptxx::v1::arguments.
+     *
+     * Long running processes that parse many command lines, such as a
+     * resident server handling forwarded client requests, can pass the
+     * previous result back in so that no allocation occurs once the storage
+     * has grown to fit the largest command line seen. If parsing throws, the
+     * storage is moved back into \a reuse so it is not lost.
+     *
+     * \param[in] argc Argument count
+     * \param[in] argv Argument vector
+     * \param[in] options A list of getoptxx::v1::option values.
+     * \param[in,out] reuse A previous result whose storage is reused; it
+     * receives the storage back if parsing throws.
+     * \return The parsed getoptxx::v1::arguments
+     * \throws std::runtime_error if there is a parsing error.
+     */
+    static auto parse(int argc, char* const argv[],
+                      std::initializer_list<option> options,
+                      arguments&& reuse) -> arguments;
+
+    /*!
+     * \brief Parse the argc/argv command line arguments given a compiled
+     * getoptxx::v1::schema.
+     *
+     * \param[in] argc Argument from main
+     * \param[in] argv Argument from main
+     * \param[in] options The compiled getoptxx::v1::schema.
+     * \return The parsed getoptxx::v1::arguments
+     * \throws std::runtime_error if there is a parsing error.
+     */
+    static auto parse(int argc, char* const argv[],
+                      schema const& options) -> arguments;
+
+    /*!
+     * \brief Parse the argc/argv command line arguments given a compiled
+     * getoptxx::v1::schema, reusing the storage of a previous result.
+     *
+     * \param[in] argc Argument count
+     * \param[in] argv Argument vector
+     * \param[in] options The compiled getoptxx::v1::schema.
+     * \param[in,out] reuse A previous result whose storage is reused; it
+     * receives the storage back if parsing throws.
+     * \return The parsed getoptxx::v1::arguments
+     * \throws std::runtime_error if there is a parsing error.
+     */
+    static auto parse(int argc, char* const argv[], schema const& options,
+                      arguments&& reuse) -> arguments;
+
+    /*!
+     * \brief Parse a URL query string or form-encoded body given a list of
+     * getoptxx::option values.
+     *
+     * Each \c name=value pair is matched against the short and long option
+     * names exactly as a command line option would be. The string is
+     * percent-decoded in place, so the returned values point into \a query
+     * and are NUL-terminated; no copies of the data are made. A leading
+     * '?' is skipped.
+     *
+     * \param[in,out] query A NUL-terminated query string, decoded in place.
+     * \param[in] options A list of getoptxx::v1::option values.
+     * \return The parsed getoptxx::v1::arguments
+     * \throws std::runtime_error if there is a parsing error.
+     */
+    static auto parse_query(char* query,
+                            std::initializer_list<option> options) -> arguments;
+
+    /*!
+     * \brief Parse a URL query string or form-encoded body given a compiled
+     * getoptxx::v1::schema.
+     *
+     * \param[in,out] query A NUL-terminated query string, decoded in place.
+     * \param[in] options The compiled getoptxx::v1::schema.
+     * \return The parsed getoptxx::v1::arguments
+     * \throws std::runtime_error if there is a parsing error.
+     */
+    static auto parse_query(char* query, schema const& options) -> arguments;
+
+    /*!
+     * \brief Parse a JSON configuration document given a list of
+     * getoptxx::option values.
+     *
+     * The document must be an object; the dotted path of each member, such
+     * as \c server.port for \c {"server":{"port":80}}, is matched against
+     * the short and long option names. Strings, numbers and \c true or
+     * \c false are accepted as values and \c null leaves the option unset.
+     * Options that take no value are set by \c true. Arrays are not
+     * supported.
+     *
+     * The document is decoded in place, so the returned values point into
+     * \a json and are NUL-terminated; no copies of the data are made and a
+     * privately memory-mapped file can be passed directly.
+     *
+     * \param[in,out] json The JSON document, decoded in place.
+     * \param[in] size The size of \a json in bytes.
+     * \param[in] options A list of getoptxx::v1::option values.
+     * \return The parsed getoptxx::v1::arguments
+     * \throws std::runtime_error if there is a parsing error.
+     */
+    static auto parse_json(char* json, std::size_t size,
+                           std::initializer_list<option> options) -> arguments;
+
+    /*!
+     * \brief Parse a JSON configuration document given a compiled
+     * getoptxx::v1::schema.
+     *
+     * \param[in,out] json The JSON document, decoded in place.
+     * \param[in] size The size of \a json in bytes.
+     * \param[in] options The compiled getoptxx::v1::schema.
+     * \return The parsed getoptxx::v1::arguments
+     * \throws std::runtime_error if there is a parsing error.
+     */
+    static auto parse_json(char* json, std::size_t size,
+                           schema const& options) -> arguments;
+
+    /*!
+     * \brief Parse a command line stored as a single string given a
+     * compiled getoptxx::v1::schema.
+     *
+     * The line is split into tokens the way a POSIX shell would split a
+     * simple command: on unquoted whitespace, with single quotes, double
+     * quotes, backslash escapes and backslash-newline line continuations.
+     * Inside double quotes a backslash only escapes \c $, \c `, \c ",
+     * \c \\ and newline. There is no expansion of any kind, so \c $ and
+     * \c ` are otherwise literal. As with argv, the first token is the
+     * program name and is skipped. The line is split in place, so the
+     * returned values point into \a line and are NUL-terminated.
+     *
+     * \param[in,out] line A NUL-terminated command line, split in place.
+     * \param[in] options The compiled getoptxx::v1::schema.
+     * \param[in] budget The getoptxx::v1::limits to enforce; the program
+     * name counts towards the limits.
+     * \return The parsed getoptxx::v1::arguments
+     * \throws std::runtime_error if there is a parsing error or a limit is
+     * exceeded.
+     */
+    static auto parse_line(char* line, schema const& options,
+                           limits const& budget = {}) -> arguments;
+
+    /*!
+     * \brief Parse the argc/argv command line arguments on top of a default
+     * command line given a compiled getoptxx::v1::schema.
+     *
+     * Options given in \a argv take precedence over the same options in
+     * \a defaults; non-option arguments in \a defaults follow those in
+     * \a argv.
+     *
+     * \param[in] argc Argument from main
+     * \param[in] argv Argument from main
+     * \param[in] options The compiled getoptxx::v1::schema.
+     * \param[in] defaults The default command line, without program name.
+     * \return The parsed getoptxx::v1::arguments
+     * \throws std::runtime_error if there is a parsing error.
+     */
+    template <std::size_t N>
+    static auto parse(int argc, char* const argv[], schema const& options,
+                      command_line<N> const& defaults) -> arguments;
+
     /*! \brief The type of the key used to look up parsed arguments. */
     using key_type = std::experimental::string_view;
 
@@ -151,7 +440,18 @@ public:
      * \param[in] key the option name to check.
      * \return true if \a key was parsed on the command line of false if not.
      */
-    bool exists(key_type const& key) const { return m_parsed.count(key)>0; }
+    bool exists(key_type const& key) const {
+        return lookup(option_key::hash(key.data(), key.size()), key)!=nullptr;
+    }
+
+    /*!
+     * \brief Indicates if an option was parsed.
+     * \param[in] key the option name, hashed at compile time, to check.
+     * \return true if \a key was parsed on the command line of false if not.
+     */
+    bool exists(option_key const& key) const {
+        return lookup(key.hash(), key.name())!=nullptr;
+    }
 
     /*!
      * \brief Get the value of a parsed argument.
@@ -160,10 +460,7 @@ public:
      * required or was provided and the value is optional.
      */
     auto operator[](key_type const& key) const {
-        if (!exists(key)) {
-            throw std::runtime_error{ "no value for '"+key.to_string()+"'" };
-        }
-        return m_parsed.find(key)->second;
+        return value(option_key::hash(key.data(), key.size()), key);
     }
 
     /*!
@@ -173,18 +470,92 @@ public:
      * required or was provided and the value is optional.
      */
     auto operator[](key_type&& key) const {
-        if (!exists(key)) {
-            throw std::runtime_error{ "no value for '"+key.to_string()+"'" };
-        }
-        return m_parsed.find(key)->second;
+        return value(option_key::hash(key.data(), key.size()), key);
+    }
+
+    /*!
+     * \brief Get the value of a parsed argument.
+     * \param[in] key the option name, hashed at compile time, to use.
+     * \return the value of the parsed argument; may be empty if no value is
+     * required or was provided and the value is optional.
+     */
+    auto operator[](option_key const& key) const {
+        return value(key.hash(), key.name());
     }
 
+    /*!
+     * \brief Look up many parsed arguments at once.
+     *
+     * For each key in the range, the corresponding bit of \a present is set
+     * if the option was parsed and the value is written to \a values, or
+     * an empty value if it was not. Keys may be names or
+     * getoptxx::v1::option_key values, whose hashes are precomputed.
+     *
+     * \param[in] first The beginning of the range of keys.
+     * \param[in] last The end of the range of keys.
+     * \param[out] present A bitmap of at least (N+63)/64 words, where N is
+     * the number of keys; bit i%64 of word i/64 is set if key i was parsed.
+     * \param[out] values An array of at least N values.
+     * \return the number of keys that were parsed.
+     */
+    template <class InputIt>
+    auto extract(InputIt first, InputIt last, std::uint64_t* present,
+                 value_type* values) const -> std::size_t;
+
     /*!
      * \brief Get the list of unparsed arguments.
      * \return the list of unparsed arguments.
      */
     auto const& unparsed() const noexcept(true) { return m_unparsed; }
 
+    /*!
+     * \brief Write the parsed and unparsed arguments as a JSON object.
+     *
+     * The object is streamed directly to \a out without building any
+     * intermediate strings, so a preallocated buffer or a stream iterator
+     * may be used. Parsed options appear under \c "options" keyed by each
+     * of their names, unparsed arguments under \c "unparsed".
+     *
+     * \param[in] out The output iterator to write characters to.
+     * \return The output iterator one past the last character written.
+     */
+    template <class OutputIt>
+    OutputIt write_json(OutputIt out) const;
+
+    /*!
+     * \brief Publish arguments for access from anywhere in the process.
+     *
+     * Published instances are never freed, not even by static destructors
+     * at exit, so a reader holding the pointer from an earlier publication
+     * never sees it freed. Publish once after parsing, or occasionally on
+     * reload.
+     *
+     * \param[in] args The arguments to publish.
+     */
+    static void publish(arguments args);
+
+    /*!
+     * \brief Get the most recently published arguments.
+     *
+     * This is a single atomic load with acquire ordering and never blocks.
+     *
+     * \return the published arguments or nullptr if none have been.
+     */
+    static auto published() noexcept(true) -> arguments const* {
+        return current().load(std::memory_order_acquire);
+    }
+
+    /*!
+     * \brief Remove all parsed and unparsed arguments, keeping the allocated
+     * storage for reuse.
+     */
+    void clear() noexcept(true) {
+        m_help = false;
+        std::fill(std::begin(m_parsed), std::end(m_parsed), entry{});
+        m_size = 0;
+        m_unparsed.clear();
+    }
+
     /*! \brief Default constructor. */
     constexpr arguments() = default;
     /*! \brief Copy constructor. */
@@ -199,8 +570,74 @@ public:
     ~arguments() noexcept(true) = default;
 
 private:
+    friend class parser;
+
+    template <class Options>
+    static void do_parse(arguments& args, int argc, char* const argv[],
+                         Options const& options);
+    template <class Options>
+    static void do_parse_query(arguments& args, char* query,
+                               Options const& options);
+    template <class Options>
+    static void do_parse_json(arguments& args, char* json, std::size_t size,
+                              Options const& options);
+
+    static auto find(std::initializer_list<option> options,
+                     key_type const& str) -> option const*;
+    static auto find(schema const& options,
+                     key_type const& str) -> option const*;
+    void store(option const& opt, value_type const& val);
+    void check_required(std::initializer_list<option> options) const;
+    void check_required(schema const& options) const;
+
+    // parsed arguments are kept in an open-addressed table so lookups can
+    // use a hash computed ahead of time; empty slots have an empty key
+    struct entry {
+        std::uint64_t hash;
+        key_type key;
+        value_type value;
+    };
+
+    auto lookup(std::uint64_t hash, key_type const& key) const noexcept(true)
+        -> entry const* {
+        if (m_parsed.empty()) return nullptr;
+        auto const mask = m_parsed.size()-1;
+        for (auto i = static_cast<std::size_t>(hash)&mask;; i = (i+1)&mask) {
+            auto const& e = m_parsed[i];
+            if (e.key.empty()) return nullptr;
+            if (e.hash==hash && e.key==key) return &e;
+        }
+    }
+
+    auto value(std::uint64_t hash, key_type const& key) const -> value_type {
+        auto const e = lookup(hash, key);
+        if (!e) {
+            throw std::runtime_error{ "no value for '"+key.to_string()+"'" };
+        }
+        return e->value;
+    }
+
+    void insert(key_type const& key, value_type const& val);
+
+    static auto hash_of(key_type const& key) noexcept(true) {
+        return option_key::hash(key.data(), key.size());
+    }
+    static auto hash_of(option_key const& key) noexcept(true) {
+        return key.hash();
+    }
+    static auto name_of(key_type const& key) noexcept(true) { return key; }
+    static auto name_of(option_key const& key) noexcept(true) {
+        return key.name();
+    }
+
+    static auto current() noexcept(true) -> std::atomic<arguments const*>& {
+        static std::atomic<arguments const*> args{ nullptr };
+        return args;
+    }
+
     bool m_help{ false };
-    std::unordered_map<key_type, value_type> m_parsed{};
+    std::vector<entry> m_parsed{};
+    std::size_t m_size{ 0 };
     std::vector<value_type> m_unparsed{};
 };
 
@@ -231,10 +668,12 @@ struct option final {
      * \param[in] name The short and long option names.
      * \param[in] aflags The \ref argument_flags of the parsed argument.
      * \param[in] oflags The \ref option_flags of the option.
+     * \param[in] description The help text of the option.
      */
     constexpr option(arguments::key_type const& name,
         argument_flags aflags = argument_flags::none,
-        option_flags oflags = option_flags::none) noexcept(true)
+        option_flags oflags = option_flags::none,
+        arguments::key_type const& description = {}) noexcept(true)
     : aflags{ aflags }, oflags{ oflags },
       shortopt{
           (name.size()>1) ? ((name[1]==',') ? &name[0] : "") : &name[0],
@@ -243,7 +682,8 @@ struct option final {
       longopt{
           (name.size()==1) ? "" : (name[1]==',') ? &name[2]      : &name[0],
           (name.size()==1) ? 0  : (name[1]==',') ? name.size()-2 : name.size()
-      }
+      },
+      description{ description }
     {}
 
     /*! \brief Copy constructor. */
@@ -260,6 +700,7 @@ struct option final {
     argument_flags const aflags{argument_flags::none};
     option_flags const oflags{option_flags::none};
     arguments::key_type const shortopt{}, longopt{};
+    arguments::key_type const description{};
 };
 
 inline std::string to_string(option const& o) {
@@ -267,62 +708,2260 @@ inline std::string to_string(option const& o) {
     else return o.longopt.to_string();
 }
 
-} // inline namespace v1
-} // namespace getoptxx
+/*!
+ * \brief A command line split into tokens at compile time.
+ *
+ * Default command lines embedded in a program can be split when the
+ * program is compiled rather than at every start:
+ * \code
+ * static constexpr auto defaults =
+ *     getoptxx::make_command_line("--threads 4 --log info");
+ * \endcode
+ * Tokens are separated by whitespace; there is no quoting. Each token is
+ * NUL-terminated and points into the command_line object.
+ */
+template <std::size_t N>
+class command_line final {
+public:
+    /*! \brief The type of a command line token. */
+    using value_type = arguments::value_type;
 
-inline auto getoptxx::v1::arguments::parse(int argc, char* const argv[],
-    std::initializer_list<option> options) -> arguments {
-    arguments args;
-    auto const argend = std::find_if(argv+1, argv+argc,
-                                     [](auto s) { return s=="--"; });
+    /*!
+     * \brief Split a command line.
+     * \param[in] line The command line string literal.
+     */
+    constexpr command_line(char const (&line)[N]) noexcept(true) {
+        bool token = false;
+        for (std::size_t i = 0; i+1<N; ++i) {
+            auto const c = line[i];
+            if (c==' ' || c=='\t' || c=='\n' || c=='\r') {
+                token = false;
+                continue;
+            }
+            if (!token) m_first[m_size++] = static_cast<offset_type>(i);
+            token = true;
+            m_text[i] = c;
+        }
+    }
 
-    for (auto&& arg=argv+1; arg!=argend && !args.help(); ++arg) {
-        if (!*arg) continue; // ignore empty arguments
+    /*!
+     * \brief Get the number of tokens.
+     * \return the number of tokens.
+     */
+    constexpr std::size_t size() const noexcept(true) { return m_size; }
 
-        if ((*arg)[0] != '-') { // non-option arguments
-            args.m_unparsed.push_back(*arg);
-            continue;
-        } else if (!(*arg)[1]) { // ignore a single '-'
-            continue;
-        }
+    /*!
+     * \brief Get a token.
+     * \param[in] i the index of the token.
+     * \return the token.
+     */
+    constexpr value_type operator[](std::size_t i) const noexcept(true) {
+        std::size_t last = m_first[i];
+        while (m_text[last]) ++last;
+        return { &m_text[m_first[i]], last-m_first[i] };
+    }
 
-        // can now assume: a[0]=='-' && a.size()>1
-        key_type const str{ ((*arg)[1]=='-') ? &(*arg)[2] : &(*arg)[1] };
-        args.m_help = (str=="h" || str=="help");
-        if (args.m_help) return args;
+private:
+    // tokens are NUL-terminated, so only their offsets are kept, in the
+    // narrowest type that can index the text
+    using offset_type = std::conditional_t<(N<=UINT16_MAX), std::uint16_t,
+        std::conditional_t<(N<=UINT32_MAX), std::uint32_t, std::size_t>>;
 
-        auto const opt = std::find_if(std::begin(options), std::end(options),
-            [&str](auto opt) { return str==opt.shortopt||str==opt.longopt; });
-        if (opt==end(options)) {
-            throw std::runtime_error{ "unknown option '"+str.to_string()+"'" };
-        }
+    char m_text[N]{};
+    offset_type m_first[N/2+1]{};
+    offset_type m_size{ 0 };
+};
 
-        auto const val = [&str,aflags=opt->aflags,&arg,&argend]()->value_type {
-            bool const present = (arg+1<argend || (*(arg+1))[0]!='-');
-            if (aflags==option::argument_flags::none) return {};
-            if (aflags==option::argument_flags::required && !present) {
-                throw std::runtime_error{
-                    "option '"+str.to_string()+"' requires a value" };
-            }
-            if (present) return *(++arg);
-            else return {};
-        }();
+/*!
+ * \brief Split a command line at compile time.
+ * \param[in] line The command line string literal.
+ * \return the getoptxx::v1::command_line
+ */
+template <std::size_t N>
+constexpr auto make_command_line(char const (&line)[N]) noexcept(true) {
+    return command_line<N>{ line };
+}
 
-        if (!opt->shortopt.empty()) args.m_parsed.emplace(opt->shortopt, val);
-        if (!opt->longopt.empty()) args.m_parsed.emplace(opt->longopt, val);
-    }
+/*!
+ * \brief A list of getoptxx::v1::option values compiled for repeated parsing.
+ *
+ * Lookups scan packed arrays of the short option characters and of the
+ * long option lengths and first bytes of the first 32 options, so most
+ * candidates are rejected while touching only a few cache lines; the long
+ * names are copied into one contiguous pool for the confirming comparison.
+ * The remaining options of larger schemas are matched with a trie that
+ * branches only until a name is unique, so a lookup follows a few edges
+ * and then compares the rest of the name once, regardless of the schema
+ * size.
+ */
+class schema final {
+public:
+    /*! \brief The type of the option names. */
+    using key_type = arguments::key_type;
 
-    std::for_each(std::begin(options), std::end(options), [&args](auto&& o) {
-        if (o.oflags != option::option_flags::required) return;
+    /*!
+     * \brief Compile a list of getoptxx::v1::option values.
+     * \param[in] options A list of getoptxx::v1::option values.
+     */
+    schema(std::initializer_list<option> options)
+    : schema(std::begin(options), std::end(options)) {}
 
-        if ((!o.shortopt.empty() && args.m_parsed.count(o.shortopt)==0)||
-            (!o.longopt.empty() && args.m_parsed.count(o.longopt)==0)) {
-            throw std::runtime_error{ "option '"+to_string(o)+"' required" };
-        }
-    });
+    /*!
+     * \brief Compile a range of getoptxx::v1::option values.
+     * \param[in] first The beginning of the range of options.
+     * \param[in] last The end of the range of options.
+     */
+    template <class InputIt>
+    schema(InputIt first, InputIt last);
 
-    args.m_unparsed.insert(std::end(args.m_unparsed), argend+1, argv+argc);
-    return args;
+    /*!
+     * \brief Create an overlay on a shared base schema.
+     *
+     * Only the additions and removals are stored in the overlay; the base is
+     * shared by all overlays built on it. Names are looked up in the
+     * additions first, which may shadow base options, and then in the base.
+     * A required base option stays required only while all of its names
+     * still find it. Iteration covers the additions only.
+     *
+     * \param[in] base The base getoptxx::v1::schema.
+     * \param[in] additions A list of getoptxx::v1::option values to add.
+     * \param[in] removals Names of base options to remove.
+     * \throws std::runtime_error if a removal names no base option.
+     */
+    schema(std::shared_ptr<schema const> base,
+           std::initializer_list<option> additions,
+           std::initializer_list<key_type> removals = {});
+
+    /*! \brief Copy constructor. */
+    schema(schema const&) = default;
+    /*! \brief Move constructor. */
+    schema(schema&&) noexcept(true) = default;
+    /*!
+     * \brief Copy assignment operator.
+     *
+     * Options have const members and cannot be assigned, so the copy is
+     * built first and then moved in.
+     */
+    schema& operator=(schema const& other) { return *this = schema(other); }
+    /*! \brief Move assignment operator. */
+    schema& operator=(schema&&) noexcept(true) = default;
+    /*! \brief Destructor. */
+    ~schema() noexcept(true) = default;
+
+    /*!
+     * \brief Get the base of an overlay.
+     * \return the base schema or nullptr if this is not an overlay.
+     */
+    auto const& base() const noexcept(true) { return m_base; }
+
+    /*!
+     * \brief Compile a text schema specification.
+     *
+     * Each line names one option as in the getoptxx::v1::option
+     * constructor, such as \c p,port or \c verbose, optionally followed
+     * by \c = if it requires a value or \c [=] if the value is optional,
+     * and then by \c ! if the option is required on the command line.
+     * The rest of the line is the option's description. Blank lines and
+     * lines starting with \c # are ignored:
+     * \code
+     * # server options
+     * debug           Turn on debug checks.
+     * p,port=!        Listen on PORT for connections.
+     * v,verbose[=]    Be verbose up to LEVEL.
+     * \endcode
+     * No copies of the names are made, so the options point into \a spec,
+     * which must outlive the schema.
+     *
+     * \param[in,out] spec The schema specification, modified in place.
+     * \param[in] size The size of \a spec in bytes.
+     * \return The compiled getoptxx::v1::schema
+     * \throws std::runtime_error if a line is not a valid option.
+     */
+    static auto from_spec(char* spec, std::size_t size) -> schema;
+
+    /*! \brief The type of an option usage profile. */
+    using profile_type = std::vector<std::pair<key_type, std::uint32_t>>;
+
+    /*!
+     * \brief Compile a list of getoptxx::v1::option values, ordering them by
+     * a usage profile.
+     * \param[in] options A list of getoptxx::v1::option values.
+     * \param[in] usage A profile returned by profile, possibly merged from
+     * many runs; the 32 most used options are placed first, where they are
+     * compared all at once, and the rest are matched by the trie.
+     */
+    schema(std::initializer_list<option> options, profile_type const& usage)
+    : schema(std::begin(options), std::end(options), usage) {}
+
+    /*!
+     * \brief Compile a range of getoptxx::v1::option values, ordering them by
+     * a usage profile.
+     * \param[in] first The beginning of the range of options.
+     * \param[in] last The end of the range of options.
+     * \param[in] usage A profile returned by profile.
+     */
+    template <class InputIt>
+    schema(InputIt first, InputIt last, profile_type const& usage);
+
+    /*!
+     * \brief Start counting how often each option is found. Copies of the
+     * schema made afterwards share the counts.
+     */
+    void enable_profile();
+
+    /*!
+     * \brief Get how often each option has been found since enable_profile.
+     * \return the count for each option, keyed by its long name or its short
+     * name if it has none; empty if profiling is not enabled.
+     */
+    auto profile() const -> profile_type;
+
+    /*!
+     * \brief Find an option by its short or long name.
+     * \param[in] str the option name to find.
+     * \return the option or nullptr if there is no option named \a str.
+     */
+    auto find(key_type const& str) const noexcept(true) -> option const*;
+
+    /*!
+     * \brief Get the number of options.
+     * \return the number of options.
+     */
+    auto size() const noexcept(true) { return m_options.size(); }
+
+    /*!
+     * \brief Get an iterator to the first option.
+     * \return an iterator to the first option.
+     */
+    auto begin() const noexcept(true) { return m_options.begin(); }
+
+    /*!
+     * \brief Get an iterator past the last option.
+     * \return an iterator past the last option.
+     */
+    auto end() const noexcept(true) { return m_options.end(); }
+
+private:
+    friend class arguments;
+    friend class parser;
+
+    // the first options, up to this many, are compared against a name at
+    // once; any others are matched by the trie
+    static constexpr std::size_t small_size = 32;
+
+    std::vector<option> m_options{};
+    std::vector<char> m_short{};           // short name or '\0' if none
+    std::vector<std::uint8_t> m_length{};  // long name length, at most 255
+    std::vector<char> m_first{};           // first byte of long name
+    std::vector<std::uint32_t> m_offset{}; // long name offset into m_pool
+    std::vector<char> m_pool{};
+    std::shared_ptr<std::atomic<std::uint32_t>> m_hits{};
+
+    // required options that every one of their names still finds: indices
+    // of this schema's own and pointers to those of its base
+    std::vector<std::uint32_t> m_required{};
+    std::vector<option const*> m_required_base{};
+
+    // the long names of options past small_size, as a trie that stops
+    // branching once a name is unique: state 0 is the root, the edges of
+    // state s are [m_edges[s], m_edges[s+1]) of m_label and m_next, and
+    // m_accept holds the index plus one of the only option that can match
+    std::vector<std::uint32_t> m_edges{};
+    std::vector<char> m_label{};
+    std::vector<std::uint32_t> m_next{};
+    std::vector<std::uint32_t> m_accept{};
+    std::vector<std::uint32_t> m_by_short{}; // option index plus one
+
+    // overlays share their base and store the removed base options sorted
+    std::shared_ptr<schema const> m_base{};
+    std::vector<option const*> m_removed{};
+
+    auto lookup(key_type const& str, bool count) const noexcept(true)
+        -> option const*;
+    auto find_local(key_type const& str, bool count) const noexcept(true)
+        -> option const*;
+    template <class Function>
+    void each_required(Function&& f) const;
+    auto required_count() const noexcept(true) {
+        return m_required.size()+m_required_base.size();
+    }
+    auto required_index(option const& opt) const noexcept(true)
+        -> std::size_t;
+
+    void index();
+    void build_trie();
+    void collect_required();
+};
+
+/*!
+ * \brief Parses command line arguments one token at a time.
+ *
+ * Interactive tools that validate a command line as it is typed can push
+ * each new token instead of parsing the whole line again; every push costs
+ * the same regardless of how many tokens came before. The tokens are not
+ * copied, so the parsed values point into the pushed tokens.
+ */
+class parser final {
+public:
+    /*! \brief The type of a command line token. */
+    using value_type = arguments::value_type;
+
+    /*!
+     * \brief Create a new parser.
+     * \param[in] options The compiled getoptxx::v1::schema, which must
+     * outlive the parser.
+     * \param[in] budget The getoptxx::v1::limits on the pushed tokens.
+     */
+    explicit parser(schema const& options, limits const& budget = {})
+        noexcept(true)
+    : m_schema{ &options }, m_limits{ budget } {}
+
+    /*!
+     * \brief Parse the next command line token.
+     * \param[in] token the token to parse.
+     * \throws std::runtime_error if the token is an unknown option, a
+     * value required by the previous option is missing, or a limit is
+     * exceeded.
+     */
+    void push(value_type const& token);
+
+    /*!
+     * \brief Indicates if the last option parsed is waiting for its value.
+     * \return true if the next token may be taken as a value.
+     */
+    bool pending() const noexcept(true) { return m_pending!=nullptr; }
+
+    /*!
+     * \brief Indicates if the tokens pushed so far form a valid command line.
+     * \return true if no required value or required option is missing.
+     */
+    bool complete() const noexcept(true) {
+        return m_args.help() ||
+            ((!m_pending ||
+              m_pending->aflags!=option::argument_flags::required) &&
+             m_required==m_schema->required_count());
+    }
+
+    /*!
+     * \brief Get the arguments parsed so far; a pending option is not yet
+     * included.
+     * \return the arguments parsed so far.
+     */
+    auto const& get() const noexcept(true) { return m_args; }
+
+    /*!
+     * \brief Finish parsing and get the parsed arguments.
+     * \return The parsed getoptxx::v1::arguments
+     * \throws std::runtime_error if a required value or option is missing.
+     */
+    auto finish() -> arguments;
+
+    /*! \brief Discard all pushed tokens, keeping the allocated storage. */
+    void reset() noexcept(true) {
+        m_args.clear();
+        m_pending = nullptr;
+        m_ended = false;
+        m_required = 0;
+        std::fill(std::begin(m_seen), std::end(m_seen), false);
+        m_tokens = 0;
+        m_bytes = 0;
+    }
+
+private:
+    friend class arguments;
+
+    void resolve();
+    void store(option const& opt, value_type const& val);
+
+    schema const* m_schema;
+    arguments m_args{};
+    option const* m_pending{ nullptr };
+    bool m_ended{ false };
+    std::size_t m_required{ 0 };
+    std::vector<bool> m_seen{}; // by schema::required_index
+    limits m_limits{};
+    std::size_t m_tokens{ 0 };
+    std::size_t m_bytes{ 0 };
+};
+
+/*!
+ * \brief Deduplicates argument values across many parsed command lines.
+ *
+ * Each distinct value is copied once into pool-owned storage and given a
+ * stable 32-bit id, so values from many command lines can be compared by
+ * id and kept after the command lines themselves are gone. Interning and
+ * lookup may be called concurrently from multiple threads.
+ */
+class value_pool final {
+public:
+    /*! \brief The type of an interned value. */
+    using value_type = arguments::value_type;
+
+    /*! \brief The type of the id of an interned value. */
+    using id_type = std::uint32_t;
+
+    /*!
+     * \brief Intern a value.
+     * \param[in] val the value to intern.
+     * \return the id of \a val, which is the same for all equal values.
+     * \throws std::length_error if the pool holds too many values.
+     */
+    auto intern(value_type const& val) -> id_type;
+
+    /*!
+     * \brief Get an interned value.
+     * \param[in] id the id returned by intern.
+     * \return the interned value, which remains valid for the lifetime of
+     * the pool.
+     */
+    auto operator[](id_type id) const -> value_type {
+        std::lock_guard<std::mutex> lock{ m_mutex };
+        return m_values.at(id);
+    }
+
+    /*!
+     * \brief Get the number of distinct values.
+     * \return the number of distinct values interned.
+     */
+    auto size() const {
+        std::lock_guard<std::mutex> lock{ m_mutex };
+        return m_values.size();
+    }
+
+    /*! \brief Default constructor. */
+    value_pool() = default;
+    value_pool(value_pool const&) = delete;
+    value_pool& operator=(value_pool const&) = delete;
+    /*! \brief Destructor. */
+    ~value_pool() noexcept(true) = default;
+
+private:
+    static constexpr std::size_t chunk_size = 4096;
+
+    mutable std::mutex m_mutex{};
+    std::unordered_map<value_type, id_type> m_ids{};
+    std::vector<value_type> m_values{};
+    std::vector<std::unique_ptr<char[]>> m_chunks{};
+    char* m_next{ nullptr };
+    std::size_t m_left{ 0 };
+};
+
+/*!
+ * \brief A keyword index over the names and descriptions of a schema.
+ *
+ * Each name and description is indexed by its three-byte substrings, so a
+ * search only verifies the options that contain every trigram of the
+ * keyword instead of scanning every description. The index is built when
+ * it is constructed, so programs only pay for it when help is requested.
+ */
+class help_index final {
+public:
+    /*!
+     * \brief Index a schema.
+     * \param[in] options The compiled getoptxx::v1::schema, which must
+     * outlive the index.
+     */
+    explicit help_index(schema const& options);
+
+    /*!
+     * \brief Find the options whose names or descriptions contain a keyword,
+     * ignoring ASCII case.
+     * \param[in] keyword the keyword to search for.
+     * \return the matching options in schema order.
+     */
+    auto search(arguments::key_type const& keyword) const
+        -> std::vector<option const*>;
+
+private:
+    static auto trigram(char const* p) noexcept(true) {
+        return (std::uint32_t{ static_cast<unsigned char>(p[0]) }<<16)|
+               (std::uint32_t{ static_cast<unsigned char>(p[1]) }<<8)|
+               std::uint32_t{ static_cast<unsigned char>(p[2]) };
+    }
+
+    schema const* m_schema;
+    std::vector<std::string> m_text{}; // lowercase names and description
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> m_grams{};
+};
+
+/*!
+ * \brief A deduplicated table of path arguments.
+ *
+ * Paths are normalized lexically as they are added: repeated and trailing
+ * slashes and \c . components are dropped and \c .. removes the preceding
+ * component, without consulting the filesystem. The normalized paths are
+ * stored as a tree of components in flat arrays, with all the component
+ * names in one pool, so paths sharing a directory prefix share its storage
+ * and equal paths are stored once.
+ */
+class path_table final {
+public:
+    /*! \brief The type of a path argument. */
+    using value_type = arguments::value_type;
+
+    /*! \brief The type of the id of a stored path. */
+    using id_type = std::uint32_t;
+
+    /*!
+     * \brief Add a path.
+     * \param[in] path the path to add.
+     * \return the id of the normalized path, which is the same for all paths
+     * that normalize to it.
+     */
+    auto add(value_type const& path) -> id_type;
+
+    /*!
+     * \brief Get a stored path.
+     * \param[in] id the id returned by add.
+     * \return the normalized path.
+     */
+    auto operator[](id_type id) const -> std::string;
+
+    /*!
+     * \brief Get the number of distinct paths.
+     * \return the number of distinct paths added.
+     */
+    auto size() const noexcept(true) { return m_size; }
+
+    /*!
+     * \brief Call a function with each distinct path, in order of their
+     * components; absolute paths come first.
+     * \param[in] f The function called with each path as a
+     * \c std::string.
+     */
+    template <class Function>
+    void for_each(Function&& f) const;
+
+private:
+    struct node {
+        id_type parent;
+        std::uint32_t offset; // of the name in m_pool
+        std::uint32_t size;
+    };
+
+    auto name(id_type id) const noexcept(true) -> value_type {
+        return { m_pool.data()+m_nodes[id].offset, m_nodes[id].size };
+    }
+    static auto hash(id_type parent, value_type const& name) noexcept(true) {
+        return option_key::hash(name.data(), name.size())^
+            (parent*0x9e3779b97f4a7c15ull);
+    }
+    void grow();
+
+    template <class Function>
+    void visit(std::vector<id_type> const& first,
+               std::vector<id_type> const& children, id_type id,
+               std::string& path, Function& f) const;
+
+    // node 0 is the relative root "." and node 1 the absolute root "/"; a
+    // child is found through m_slots, an open-addressed table of node ids
+    // plus one hashed by parent and name
+    std::string m_pool{};
+    std::vector<node> m_nodes{ { 0, 0, 0 }, { 1, 0, 0 } };
+    std::vector<bool> m_added{ false, false };
+    std::vector<id_type> m_slots{};
+    std::size_t m_size{ 0 };
+};
+
+#if defined(GETOPTXX_HAVE_FILES)
+
+/*!
+ * \brief Start reading the contents of a file named by an option value.
+ *
+ * The file is read on another thread, so a program can start loading the
+ * files named by options such as \c --cert or \c --rules right after
+ * parsing and wait for them only when the contents are needed.
+ *
+ * \param[in] path The path of the file to read.
+ * \return A future holding the file contents.
+ * \throws std::runtime_error from the future's get if the file cannot be
+ * read.
+ */
+inline auto load_file(arguments::value_type const& path)
+    -> std::future<std::string> {
+    return std::async(std::launch::async, [path=path.to_string()]() {
+        auto const error = [&path]() {
+            return std::runtime_error{ "cannot read '"+path+"'" };
+        };
+
+        std::unique_ptr<std::FILE, int(*)(std::FILE*)> file{
+            std::fopen(path.c_str(), "rb"), &std::fclose };
+        if (!file) throw error();
+
+        // read straight into the result when the size is known, then keep
+        // reading for files whose size is not, such as pipes
+        std::string contents{};
+        std::size_t used = 0;
+        if (std::fseek(file.get(), 0, SEEK_END)==0) {
+            auto const size = std::ftell(file.get());
+            if (size>0) contents.resize(static_cast<std::size_t>(size));
+            std::rewind(file.get());
+        }
+
+        for (;;) {
+            used += std::fread(&contents[used], 1, contents.size()-used,
+                               file.get());
+            if (used<contents.size()) break; // end of file or error
+
+            // the result is full: look for more data before growing it, so
+            // a file of the expected size is never reallocated and copied
+            char probe[4096];
+            auto const n = std::fread(probe, 1, sizeof probe, file.get());
+            if (n==0) break;
+            contents.resize(used+n+65536);
+            std::memcpy(&contents[used], probe, n);
+            used += n;
+        }
+        contents.resize(used);
+        if (std::ferror(file.get())) throw error();
+        return contents;
+    });
+}
+
+#endif // defined(GETOPTXX_HAVE_FILES)
+
+#if defined(GETOPTXX_HAVE_PATHS)
+
+/*! \brief The kinds of filesystem path accepted by check_paths. */
+enum class path_kind : short {
+    any,       /*!< Any existing, readable path. */
+    file,      /*!< An existing, readable regular file. */
+    directory, /*!< An existing, readable directory. */
+};
+
+/*!
+ * \brief Check that a range of path arguments exist, are readable and are
+ * of the expected kind.
+ *
+ * The checks are spread over several threads so that the filesystem
+ * metadata reads overlap, which matters when there are many paths and the
+ * caches are cold. Each path must be NUL-terminated, as all values parsed
+ * from argv, parse_query, parse_json and parse_line are.
+ *
+ * \param[in] first The beginning of the range of paths.
+ * \param[in] last The end of the range of paths.
+ * \param[in] kind The getoptxx::v1::path_kind the paths must have.
+ * \param[in] threads The maximum number of threads to use.
+ * \throws std::runtime_error naming the first path, by position in the
+ * range, that fails a check.
+ */
+template <class RandomIt>
+void check_paths(RandomIt first, RandomIt last, path_kind kind,
+                 unsigned threads = std::thread::hardware_concurrency());
+
+/*!
+ * \brief Expand a glob pattern argument, calling a function with each
+ * matching path.
+ *
+ * The pattern is matched one path component at a time as by \c fnmatch(3);
+ * a \c ** component matches any number of directories but, as bash's
+ * \c globstar, does not descend through symbolic links. Leading dots must
+ * be matched explicitly. Directories are read by several threads at once
+ * and each match is passed to \a found as soon as it is found, so no list
+ * of matches is built. \a found is never called concurrently and the order
+ * of the matches is unspecified. A pattern that matches nothing produces
+ * no calls; a trailing \c ** matches everything below its directory.
+ *
+ * \param[in] pattern The glob pattern.
+ * \param[in] found The function called with each matching path as a
+ * \c std::string.
+ * \param[in] threads The maximum number of threads to use.
+ * \throws any exception thrown by \a found, after all threads stop;
+ * \a found is not called again once it has thrown.
+ */
+template <class Callback>
+void expand_glob(arguments::value_type const& pattern, Callback&& found,
+                 unsigned threads = std::thread::hardware_concurrency());
+
+#endif // defined(GETOPTXX_HAVE_PATHS)
+
+#if defined(GETOPTXX_HAVE_EARLY)
+
+/*! \brief The result of getoptxx::v1::early_find. */
+struct early_result final {
+    bool present;                /*!< The option is on the command line. */
+    arguments::value_type value; /*!< The value of the option, if any. */
+    bool truncated;              /*!< The command line was cut short. */
+};
+
+/*!
+ * \brief Find an option on the process command line before \c main runs.
+ *
+ * Libraries that configure themselves in static initializers, such as an
+ * allocator or a logging sink, can read their options before \c main
+ * parses the command line. The command line is read once from
+ * \c /proc/self/cmdline into a static buffer of 128 KiB; nothing is
+ * allocated and no other static object is used, so this is safe to call
+ * from any static initializer. Arguments are matched as by
+ * getoptxx::v1::arguments::parse, and the first occurrence of the option
+ * wins, except that \c -h and \c --help do not end the search.
+ *
+ * A command line longer than the buffer is read only up to the last whole
+ * argument that fits, and the result's \c truncated member is set. The
+ * option is then reported present only if it and its value were read in
+ * full; otherwise it may still appear in the part that was not read.
+ *
+ * \param[in] opt The getoptxx::v1::option to find.
+ * \return whether the option was found, and its value.
+ */
+inline auto early_find(option const& opt) -> early_result;
+
+#endif // defined(GETOPTXX_HAVE_EARLY)
+
+} // inline namespace v1
+} // namespace getoptxx
+
+#if defined(GETOPTXX_HAVE_EARLY)
+
+inline auto getoptxx::v1::early_find(option const& opt) -> early_result {
+    // all three are constant-initialized, so they are ready before any
+    // dynamic initialization runs
+    static char cmdline[131072];
+    static std::size_t size = 0;
+    static bool truncated = false;
+    static std::once_flag once;
+
+    std::call_once(once, []() {
+        auto const fd = ::open("/proc/self/cmdline", O_RDONLY|O_CLOEXEC);
+        if (fd<0) return;
+        while (size<sizeof cmdline-1) {
+            auto const n = ::read(fd, cmdline+size, sizeof cmdline-1-size);
+            if (n<=0) break;
+            size += static_cast<std::size_t>(n);
+        }
+        char more;
+        truncated = (size==sizeof cmdline-1 && ::read(fd, &more, 1)>0);
+        ::close(fd);
+
+        // drop the argument that was cut, keeping only whole arguments
+        if (truncated) {
+            while (size>0 && cmdline[size-1]!='\0') --size;
+        }
+        cmdline[size] = '\0';
+    });
+
+    auto const last = cmdline+size;
+    auto arg = cmdline+std::char_traits<char>::length(cmdline)+1; // argv[0]
+    while (arg<last) {
+        arguments::key_type const tok{ arg };
+        arg += tok.size()+1;
+
+        if (tok=="--") break;
+        if (tok.size()<2 || tok[0]!='-') continue;
+
+        auto const str = tok.substr((tok[1]=='-') ? 2 : 1);
+        if (str.empty() || (str!=opt.shortopt && str!=opt.longopt)) continue;
+
+        if (opt.aflags!=option::argument_flags::none && arg<last &&
+            *arg!='-') {
+            return { true, arguments::key_type{ arg }, truncated };
+        }
+        // the value may have been in the part that was not read
+        if (truncated && opt.aflags!=option::argument_flags::none &&
+            arg>=last) {
+            return { false, {}, truncated };
+        }
+        return { true, {}, truncated };
+    }
+    return { false, {}, truncated };
+}
+
+#endif // defined(GETOPTXX_HAVE_EARLY)
+
+#if defined(GETOPTXX_HAVE_PATHS)
+
+template <class RandomIt>
+void getoptxx::v1::check_paths(RandomIt first, RandomIt last, path_kind kind,
+                               unsigned threads) {
+    enum : unsigned char { ok, missing, wrong_kind, unreadable };
+
+    auto const count = static_cast<std::size_t>(last-first);
+    std::vector<unsigned char> status(count, ok);
+
+    auto const check = [first,kind,&status](std::size_t i) {
+        struct stat st;
+        auto const path = first[i].data();
+        if (::stat(path, &st)!=0) status[i] = missing;
+        else if ((kind==path_kind::file && !S_ISREG(st.st_mode)) ||
+                 (kind==path_kind::directory && !S_ISDIR(st.st_mode))) {
+            status[i] = wrong_kind;
+        } else if (::access(path, R_OK)!=0) status[i] = unreadable;
+    };
+
+    // each share is every n-th path, so a thread writes only its own
+    // entries; the calling thread takes the shares of any thread that
+    // could not be started
+    auto const n = std::max(1u, std::min<unsigned>(threads,
+        static_cast<unsigned>(std::min<std::size_t>(count, 64))));
+    auto const share = [&check,count,n](unsigned t) {
+        for (std::size_t i = t; i<count; i += n) check(i);
+    };
+
+    std::vector<std::thread> workers{};
+    workers.reserve(n-1);
+    unsigned started = 1;
+    try {
+        for (; started<n; ++started) workers.emplace_back(share, started);
+    } catch (std::system_error const&) {}
+    share(0);
+    for (auto t = started; t<n; ++t) share(t);
+    for (auto&& w : workers) w.join();
+
+    auto const bad = std::find_if(std::begin(status), std::end(status),
+                                  [](unsigned char c) { return c!=ok; });
+    if (bad==std::end(status)) return;
+
+    auto const i = static_cast<std::size_t>(bad-std::begin(status));
+    char const* const what[] = {
+        "", "does not exist",
+        (kind==path_kind::file) ? "is not a regular file" : "is not a directory",
+        "is not readable" };
+    throw std::runtime_error{ "path '"+std::string{ first[i].data() }+
+        "' (argument "+std::to_string(i+1)+") "+what[*bad] };
+}
+
+template <class Callback>
+void getoptxx::v1::expand_glob(arguments::value_type const& pattern,
+                               Callback&& found, unsigned threads) {
+    // split the pattern into components; an absolute pattern starts at "/"
+    std::vector<std::string> parts{};
+    std::string root{ (!pattern.empty() && pattern[0]=='/') ? "/" : "" };
+    for (std::size_t pos = 0; pos<pattern.size();) {
+        auto end = pattern.find('/', pos);
+        if (end==arguments::value_type::npos) end = pattern.size();
+        if (end>pos) parts.push_back(pattern.substr(pos, end-pos).to_string());
+        pos = end+1;
+    }
+    if (parts.empty()) return;
+
+    auto const join = [](std::string const& base, char const* name) {
+        if (base.empty()) return std::string{ name };
+        if (base.back()=='/') return base+name;
+        return base+'/'+name;
+    };
+
+    auto const is_dir = [](std::string const& path) {
+        struct stat st;
+        return ::stat(path.c_str(), &st)==0 && S_ISDIR(st.st_mode);
+    };
+
+    // ** does not descend through symbolic links, as bash's globstar, so a
+    // link back up the tree cannot make the walk grow without bound
+    auto const is_real_dir = [](dirent const* entry, std::string const& path) {
+#if defined(DT_DIR)
+        if (entry->d_type!=DT_UNKNOWN) return entry->d_type==DT_DIR;
+#endif
+        (void)entry;
+        struct stat st;
+        return ::lstat(path.c_str(), &st)==0 && S_ISDIR(st.st_mode);
+    };
+
+    // directories still to be read: the path so far and the next component
+    std::deque<std::pair<std::string, std::size_t>> work{ { root, 0 } };
+    std::size_t busy = 0;
+    bool stop = false;
+    std::atomic<bool> failed{ false }; // set under found_mutex
+    std::exception_ptr error{};
+    std::mutex mutex{}, found_mutex{};
+    std::condition_variable ready{};
+
+    // once found has thrown it is not called again, even by threads that
+    // are still part way through a directory
+    auto const emit = [&](std::string const& path) {
+        std::lock_guard<std::mutex> lock{ found_mutex };
+        if (failed.load(std::memory_order_relaxed)) return;
+        try {
+            found(path);
+        } catch (...) {
+            failed.store(true, std::memory_order_relaxed);
+            throw;
+        }
+    };
+
+    auto const add = [&](std::string path, std::size_t k) {
+        std::lock_guard<std::mutex> lock{ mutex };
+        work.emplace_back(std::move(path), k);
+        ready.notify_one();
+    };
+
+    auto const visit = [&](std::string const& base, std::size_t k) {
+        auto const& part = parts[k];
+        auto const last = (k+1==parts.size());
+
+        if (part=="**") {
+            if (!last) add(base, k+1);
+        } else if (part.find_first_of("*?[\\")==std::string::npos) {
+            auto path = join(base, part.c_str());
+            struct stat st;
+            if (last) {
+                if (::lstat(path.c_str(), &st)==0) emit(path);
+            } else if (is_dir(path)) {
+                add(std::move(path), k+1);
+            }
+            return;
+        }
+
+        // closed on every exit, including an exception from found
+        std::unique_ptr<DIR, int(*)(DIR*)> const dir{
+            ::opendir(base.empty() ? "." : base.c_str()), &::closedir };
+        if (!dir) return;
+        while (auto const entry = ::readdir(dir.get())) {
+            if (failed.load(std::memory_order_relaxed)) break;
+            auto const name = entry->d_name;
+            if (!std::strcmp(name, ".") || !std::strcmp(name, "..")) continue;
+
+            if (part=="**") {
+                if (name[0]=='.') continue;
+                auto path = join(base, name);
+                if (last) emit(path);
+                if (is_real_dir(entry, path)) add(std::move(path), k);
+            } else if (::fnmatch(part.c_str(), name, FNM_PERIOD)==0) {
+                auto path = join(base, name);
+                if (last) emit(path);
+                else if (is_dir(path)) add(std::move(path), k+1);
+            }
+        }
+    };
+
+    auto const worker = [&]() {
+        std::unique_lock<std::mutex> lock{ mutex };
+        for (;;) {
+            ready.wait(lock, [&]{ return stop || !work.empty() || busy==0; });
+            if (stop || work.empty()) break;
+
+            auto item = std::move(work.front());
+            work.pop_front();
+            ++busy;
+            lock.unlock();
+
+            try {
+                visit(item.first, item.second);
+            } catch (...) {
+                lock.lock();
+                if (!error) error = std::current_exception();
+                stop = true;
+                --busy;
+                ready.notify_all();
+                break;
+            }
+
+            lock.lock();
+            if (--busy==0 && work.empty()) ready.notify_all();
+        }
+    };
+
+    // the calling thread is also a worker, so the walk goes on with
+    // whatever threads could be started
+    std::vector<std::thread> workers{};
+    auto const n = std::max(1u, std::min(threads, 64u));
+    workers.reserve(n-1);
+    try {
+        for (unsigned t = 1; t<n; ++t) workers.emplace_back(worker);
+    } catch (std::system_error const&) {}
+    worker();
+    for (auto&& w : workers) w.join();
+
+    if (error) std::rethrow_exception(error);
+}
+
+#endif // defined(GETOPTXX_HAVE_PATHS)
+
+inline getoptxx::v1::help_index::help_index(schema const& options)
+: m_schema{ &options } {
+    auto const lower = [](char c) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    };
+
+    m_text.reserve(options.size());
+    for (auto&& o : options) {
+        std::string text{};
+        text.reserve(o.shortopt.size()+o.longopt.size()+o.description.size()+2);
+        for (auto&& part : { o.shortopt, o.longopt, o.description }) {
+            if (!text.empty()) text += '\n';
+            std::transform(std::begin(part), std::end(part),
+                           std::back_inserter(text), lower);
+        }
+        m_text.push_back(std::move(text));
+    }
+
+    for (std::uint32_t i = 0; i<m_text.size(); ++i) {
+        auto const& text = m_text[i];
+        for (std::size_t j = 0; j+3<=text.size(); ++j) {
+            auto& posting = m_grams[trigram(&text[j])];
+            if (posting.empty() || posting.back()!=i) posting.push_back(i);
+        }
+    }
+}
+
+inline auto getoptxx::v1::help_index::search(
+    arguments::key_type const& keyword) const -> std::vector<option const*> {
+    std::vector<option const*> found{};
+    if (keyword.empty()) return found;
+
+    std::string key{};
+    key.reserve(keyword.size());
+    std::transform(std::begin(keyword), std::end(keyword),
+        std::back_inserter(key), [](char c) {
+            return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        });
+
+    // candidates are the shortest posting list of the keyword's trigrams;
+    // keywords too short to have a trigram check every option
+    std::vector<std::uint32_t> const* candidates = nullptr;
+    for (std::size_t j = 0; j+3<=key.size(); ++j) {
+        auto const posting = m_grams.find(trigram(&key[j]));
+        if (posting==m_grams.end()) return found;
+        if (!candidates || posting->second.size()<candidates->size()) {
+            candidates = &posting->second;
+        }
+    }
+
+    auto const first = m_schema->begin();
+    auto const check = [&](std::uint32_t i) {
+        if (m_text[i].find(key)!=std::string::npos) found.push_back(&first[i]);
+    };
+
+    if (candidates) {
+        for (auto&& i : *candidates) check(i);
+    } else {
+        for (std::uint32_t i = 0; i<m_text.size(); ++i) check(i);
+    }
+    return found;
+}
+
+inline auto getoptxx::v1::path_table::add(value_type const& path) -> id_type {
+    id_type id = (!path.empty() && path[0]=='/') ? 1 : 0;
+
+    for (std::size_t pos = 0; pos<path.size();) {
+        auto end = path.find('/', pos);
+        if (end==value_type::npos) end = path.size();
+        auto const part = path.substr(pos, end-pos);
+        pos = end+1;
+
+        if (part.empty() || part==".") continue;
+        if (part==".." && id!=0) {
+            // ".." above "/" is "/"; above a relative ".." it accumulates
+            if (id==1) continue;
+            if (name(id)!="..") {
+                id = m_nodes[id].parent;
+                continue;
+            }
+        }
+
+        if (2*m_nodes.size()>=m_slots.size()) grow();
+        auto const mask = m_slots.size()-1;
+        auto slot = hash(id, part)&mask;
+        for (; m_slots[slot]; slot = (slot+1)&mask) {
+            auto const child = m_slots[slot]-1;
+            if (m_nodes[child].parent==id && name(child)==part) break;
+        }
+        if (m_slots[slot]) {
+            id = m_slots[slot]-1;
+            continue;
+        }
+
+        if (m_nodes.size()>=UINT32_MAX-1 ||
+            m_pool.size()+part.size()>UINT32_MAX) {
+            throw std::length_error{ "too many paths in path_table" };
+        }
+        auto const next = static_cast<id_type>(m_nodes.size());
+        m_nodes.push_back({ id, static_cast<std::uint32_t>(m_pool.size()),
+                            static_cast<std::uint32_t>(part.size()) });
+        m_pool.append(part.data(), part.size());
+        m_added.push_back(false);
+        m_slots[slot] = next+1;
+        id = next;
+    }
+
+    if (!m_added[id]) {
+        m_added[id] = true;
+        ++m_size;
+    }
+    return id;
+}
+
+inline void getoptxx::v1::path_table::grow() {
+    std::vector<id_type> slots(std::max<std::size_t>(16, 2*m_slots.size()));
+    auto const mask = slots.size()-1;
+    for (id_type id = 2; id<m_nodes.size(); ++id) {
+        auto slot = hash(m_nodes[id].parent, name(id))&mask;
+        while (slots[slot]) slot = (slot+1)&mask;
+        slots[slot] = id+1;
+    }
+    m_slots.swap(slots);
+}
+
+inline auto getoptxx::v1::path_table::operator[](id_type id) const
+    -> std::string {
+    if (id<2) return (id==0) ? "." : "/";
+
+    std::vector<value_type> parts{};
+    for (; id>1; id = m_nodes[id].parent) parts.push_back(name(id));
+
+    std::string path{ (id==1) ? "/" : "" };
+    for (auto part = parts.rbegin(); part!=parts.rend(); ++part) {
+        if (!path.empty() && path.back()!='/') path += '/';
+        path.append(part->data(), part->size());
+    }
+    return path;
+}
+
+template <class Function>
+void getoptxx::v1::path_table::for_each(Function&& f) const {
+    // the children of node i are children[first[i]..first[i+1]), sorted by
+    // name; nodes are only ever added after their parent
+    std::vector<id_type> first(m_nodes.size()+1, 0);
+    for (id_type id = 2; id<m_nodes.size(); ++id) ++first[m_nodes[id].parent+1];
+    for (std::size_t i = 1; i<first.size(); ++i) first[i] += first[i-1];
+
+    std::vector<id_type> children(m_nodes.size()-2);
+    {
+        auto next = first;
+        for (id_type id = 2; id<m_nodes.size(); ++id) {
+            children[next[m_nodes[id].parent]++] = id;
+        }
+    }
+    for (std::size_t i = 0; i+1<first.size(); ++i) {
+        std::sort(&children[0]+first[i], &children[0]+first[i+1],
+            [this](id_type a, id_type b) { return name(a)<name(b); });
+    }
+
+    std::string path{ "/" };
+    if (m_added[1]) f(path);
+    visit(first, children, 1, path, f);
+
+    path.clear();
+    if (m_added[0]) f(std::string{ "." });
+    visit(first, children, 0, path, f);
+}
+
+template <class Function>
+void getoptxx::v1::path_table::visit(std::vector<id_type> const& first,
+    std::vector<id_type> const& children, id_type id, std::string& path,
+    Function& f) const {
+    for (auto i = first[id]; i<first[id+1]; ++i) {
+        auto const child = children[i];
+        auto const size = path.size();
+        if (!path.empty() && path.back()!='/') path += '/';
+        auto const part = name(child);
+        path.append(part.data(), part.size());
+
+        if (m_added[child]) f(path);
+        visit(first, children, child, path, f);
+        path.resize(size);
+    }
+}
+
+inline auto getoptxx::v1::value_pool::intern(value_type const& val)
+    -> id_type {
+    std::lock_guard<std::mutex> lock{ m_mutex };
+
+    auto const found = m_ids.find(val);
+    if (found!=m_ids.end()) return found->second;
+
+    if (m_values.size()>=UINT32_MAX) {
+        throw std::length_error{ "too many values in value_pool" };
+    }
+
+    // values are copied into chunks that never move, so the views held by
+    // m_ids and m_values stay valid as the pool grows
+    if (val.size()>m_left) {
+        auto const size = std::max(std::size_t{ chunk_size }, val.size());
+        m_chunks.emplace_back(new char[size]);
+        m_next = m_chunks.back().get();
+        m_left = size;
+    }
+
+    std::copy(std::begin(val), std::end(val), m_next);
+    value_type const copy{ m_next, val.size() };
+    m_next += val.size();
+    m_left -= val.size();
+
+    auto const id = static_cast<id_type>(m_values.size());
+    m_values.push_back(copy);
+    m_ids.emplace(copy, id);
+    return id;
+}
+
+template <class InputIt>
+getoptxx::v1::schema::schema(InputIt first, InputIt last)
+: m_options(first, last) {
+    index();
+    collect_required();
+}
+
+template <class InputIt>
+getoptxx::v1::schema::schema(InputIt first, InputIt last,
+                             profile_type const& usage)
+: m_options(first, last) {
+    std::unordered_map<key_type, std::uint64_t> counts{};
+    for (auto&& u : usage) counts[u.first] += u.second;
+
+    std::vector<std::pair<std::uint64_t, std::size_t>> order{};
+    order.reserve(m_options.size());
+    for (std::size_t i = 0; i<m_options.size(); ++i) {
+        auto const& o = m_options[i];
+        auto const c = counts.find(o.longopt.empty() ? o.shortopt : o.longopt);
+        order.emplace_back((c==counts.end()) ? 0 : c->second, i);
+    }
+
+    std::stable_sort(std::begin(order), std::end(order),
+        [](auto&& a, auto&& b) { return a.first>b.first; });
+
+    std::vector<option> sorted{};
+    sorted.reserve(m_options.size());
+    for (auto&& o : order) sorted.push_back(m_options[o.second]);
+    m_options.swap(sorted);
+    index();
+    collect_required();
+}
+
+inline auto getoptxx::v1::schema::from_spec(char* spec, std::size_t size)
+    -> schema {
+    using aflags = option::argument_flags;
+    using oflags = option::option_flags;
+
+    std::vector<option> options{};
+    auto const last = spec+size;
+    std::size_t line = 0;
+
+    for (auto pos = spec; pos<last;) {
+        auto const eol = std::find(pos, last, '\n');
+        auto end = eol;
+        ++line;
+
+        auto const space = [](char c) {
+            return c==' ' || c=='\t' || c=='\r';
+        };
+        while (pos!=end && space(*pos)) ++pos;
+        while (end!=pos && space(end[-1])) --end;
+
+        if (pos!=end && *pos!='#') {
+            auto const gap = std::find_if(pos, end, space);
+            auto const text = std::find_if_not(gap, end, space);
+            key_type const description{ text,
+                                        static_cast<std::size_t>(end-text) };
+            end = gap;
+
+            auto const required = (end[-1]=='!');
+            if (required) --end;
+
+            auto flags = aflags::none;
+            if (end-pos>=3 && key_type{ end-3, 3 }=="[=]") {
+                flags = aflags::optional;
+                end -= 3;
+            } else if (end!=pos && end[-1]=='=') {
+                flags = aflags::required;
+                --end;
+            }
+
+            key_type const name{ pos, static_cast<std::size_t>(end-pos) };
+            auto const valid = !name.empty() && std::none_of(
+                std::begin(name), std::end(name), [&space](char c) {
+                    return space(c) || c=='=' || c=='!' || c=='[' || c==']';
+                }) && name[0]!=',' && name.find(',', 2)==key_type::npos &&
+                (name.size()<2 || name[1]!=',' || name.size()>2);
+            if (!valid) {
+                throw std::runtime_error{
+                    "invalid option on line "+std::to_string(line) };
+            }
+
+            if (end!=last) *end = '\0';
+            options.emplace_back(name, flags,
+                required ? oflags::required : oflags::none, description);
+        }
+
+        pos = (eol==last) ? last : eol+1;
+    }
+
+    return schema(std::begin(options), std::end(options));
+}
+
+inline void getoptxx::v1::schema::enable_profile() {
+    m_hits.reset(new std::atomic<std::uint32_t>[m_options.size()](),
+                 std::default_delete<std::atomic<std::uint32_t>[]>{});
+}
+
+inline auto getoptxx::v1::schema::profile() const -> profile_type {
+    profile_type usage{};
+    if (!m_hits) return usage;
+
+    usage.reserve(m_options.size());
+    for (std::size_t i = 0; i<m_options.size(); ++i) {
+        auto const& o = m_options[i];
+        usage.emplace_back(o.longopt.empty() ? o.shortopt : o.longopt,
+                           m_hits.get()[i].load(std::memory_order_relaxed));
+    }
+    return usage;
+}
+
+inline void getoptxx::v1::schema::index() {
+    std::size_t pool = 0;
+    for (auto&& o : m_options) pool += o.longopt.size();
+
+    m_short.reserve(m_options.size());
+    m_length.reserve(m_options.size());
+    m_first.reserve(m_options.size());
+    m_offset.reserve(m_options.size());
+    m_pool.reserve(pool);
+
+    for (std::size_t i = 0; i<m_options.size(); ++i) {
+        auto const& o = m_options[i];
+        m_short.push_back(o.shortopt.empty() ? '\0' : o.shortopt[0]);
+        m_length.push_back(static_cast<std::uint8_t>(
+            std::min<std::size_t>(o.longopt.size(), 255)));
+        m_first.push_back(o.longopt.empty() ? '\0' : o.longopt[0]);
+        m_offset.push_back(static_cast<std::uint32_t>(m_pool.size()));
+        m_pool.insert(std::end(m_pool), std::begin(o.longopt),
+                      std::end(o.longopt));
+    }
+
+    if (m_options.size()<=small_size) { // pad for the all-at-once compare
+        m_short.resize(small_size, '\0');
+        m_length.resize(small_size, 0);
+        m_first.resize(small_size, '\0');
+    } else {
+        build_trie();
+    }
+}
+
+inline void getoptxx::v1::schema::build_trie() {
+    // names sorted with the first option of each name kept, so every state
+    // covers a contiguous range of them
+    std::vector<std::pair<key_type, std::uint32_t>> names{};
+    m_by_short.assign(256, 0);
+    for (std::size_t i = small_size; i<m_options.size(); ++i) {
+        auto const& o = m_options[i];
+        auto const id = static_cast<std::uint32_t>(i+1);
+        if (!o.shortopt.empty()) {
+            auto& s = m_by_short[static_cast<unsigned char>(o.shortopt[0])];
+            if (!s) s = id;
+        }
+        if (!o.longopt.empty()) names.emplace_back(o.longopt, id);
+    }
+    std::stable_sort(std::begin(names), std::end(names),
+        [](auto&& a, auto&& b) { return a.first<b.first; });
+    names.erase(std::unique(std::begin(names), std::end(names),
+        [](auto&& a, auto&& b) { return a.first==b.first; }), std::end(names));
+
+    // states are numbered breadth first, so each state's edges are added
+    // together and in the order of the states
+    struct range { std::size_t first, last, depth; };
+    std::vector<range> work{ { 0, names.size(), 0 } };
+    m_edges.clear();
+    m_label.clear();
+    m_next.clear();
+    m_accept.assign(1, 0);
+
+    for (std::size_t next = 0; next<work.size(); ++next) {
+        auto r = work[next];
+        m_edges.push_back(static_cast<std::uint32_t>(m_label.size()));
+        auto const state = m_edges.size()-1;
+
+        if (r.last-r.first==1) { // unique from here on
+            m_accept[state] = names[r.first].second;
+            continue;
+        }
+        if (r.first!=r.last && names[r.first].first.size()==r.depth) {
+            m_accept[state] = names[r.first++].second;
+        }
+
+        while (r.first!=r.last) {
+            auto const c = names[r.first].first[r.depth];
+            auto last = r.first+1;
+            while (last!=r.last && names[last].first[r.depth]==c) ++last;
+
+            m_label.push_back(c);
+            m_next.push_back(static_cast<std::uint32_t>(m_accept.size()));
+            m_accept.push_back(0);
+            work.push_back({ r.first, last, r.depth+1 });
+            r.first = last;
+        }
+    }
+    m_edges.push_back(static_cast<std::uint32_t>(m_label.size()));
+}
+
+inline getoptxx::v1::schema::schema(std::shared_ptr<schema const> base,
+    std::initializer_list<option> additions,
+    std::initializer_list<key_type> removals)
+: m_options(std::begin(additions), std::end(additions)),
+  m_base{ std::move(base) } {
+    index();
+    if (!m_base) {
+        collect_required();
+        return;
+    }
+
+    for (auto&& name : removals) {
+        auto const opt = m_base->lookup(name, false);
+        if (!opt) {
+            throw std::runtime_error{ "unknown option '"+name.to_string()+"'" };
+        }
+        m_removed.push_back(opt);
+    }
+    std::sort(std::begin(m_removed), std::end(m_removed),
+              std::less<option const*>{});
+    collect_required();
+}
+
+inline auto getoptxx::v1::schema::find(key_type const& str) const
+    noexcept(true) -> option const* {
+    return lookup(str, true);
+}
+
+inline auto getoptxx::v1::schema::lookup(key_type const& str,
+    bool count) const noexcept(true) -> option const* {
+    if (auto const opt = find_local(str, count)) return opt;
+    if (!m_base) return nullptr;
+
+    auto const opt = m_base->lookup(str, count);
+    if (!opt || std::binary_search(std::begin(m_removed), std::end(m_removed),
+                                   opt, std::less<option const*>{})) {
+        return nullptr;
+    }
+    return opt;
+}
+
+template <class Function>
+void getoptxx::v1::schema::each_required(Function&& f) const {
+    for (auto&& i : m_required) f(m_options[i]);
+    for (auto&& opt : m_required_base) f(*opt);
+}
+
+inline auto getoptxx::v1::schema::required_index(option const& opt) const
+    noexcept(true) -> std::size_t {
+    for (std::size_t i = 0; i<m_required.size(); ++i) {
+        if (&m_options[m_required[i]]==&opt) return i;
+    }
+    auto const base = std::find(std::begin(m_required_base),
+                                std::end(m_required_base), &opt);
+    if (base==std::end(m_required_base)) return SIZE_MAX;
+    return m_required.size()+
+        static_cast<std::size_t>(base-std::begin(m_required_base));
+}
+
+inline void getoptxx::v1::schema::collect_required() {
+    // an option shadowed by an earlier or overlaid option of the same name,
+    // or removed by an overlay, can no longer be given, so it is not required
+    auto const reachable = [this](option const& o) {
+        return (o.shortopt.empty() || lookup(o.shortopt, false)==&o) &&
+            (o.longopt.empty() || lookup(o.longopt, false)==&o);
+    };
+
+    m_required.clear();
+    m_required_base.clear();
+    for (std::size_t i = 0; i<m_options.size(); ++i) {
+        auto const& o = m_options[i];
+        if (o.oflags==option::option_flags::required && reachable(o)) {
+            m_required.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+    if (m_base) {
+        m_base->each_required([this,&reachable](option const& o) {
+            if (reachable(o)) m_required_base.push_back(&o);
+        });
+    }
+}
+
+inline auto getoptxx::v1::schema::find_local(key_type const& str,
+    bool count) const noexcept(true) -> option const* {
+    auto const found = [this,count](std::size_t i) {
+        if (count && m_hits) {
+            m_hits.get()[i].fetch_add(1, std::memory_order_relaxed);
+        }
+        return &m_options[i];
+    };
+
+    auto const n = str.size();
+    if (n==0) return nullptr;
+    auto const len = static_cast<std::uint8_t>(std::min<std::size_t>(n, 255));
+    auto const c = str[0];
+
+    auto const matches = [this,&str,n,len](std::size_t i) {
+        return (len<255 || m_options[i].longopt.size()==n) &&
+            std::memcmp(&m_pool[m_offset[i]], str.data(), n)==0;
+    };
+
+    {
+        // compare against the first options at once: the fixed trip count
+        // over the padded arrays lets the compiler vectorize these loops
+        std::uint32_t shorts = 0, longs = 0;
+        if (n==1 && c!='\0') {
+            for (std::size_t i = 0; i<small_size; ++i) {
+                shorts |= std::uint32_t{ m_short[i]==c }<<i;
+            }
+        }
+        for (std::size_t i = 0; i<small_size; ++i) {
+            longs |= std::uint32_t{ m_length[i]==len && m_first[i]==c }<<i;
+        }
+
+        // the first option matching by either name wins, as in a scan in
+        // option order, so short and long candidates are taken together
+        auto const both = shorts|longs;
+        for (std::size_t i = 0; i<small_size && (both>>i); ++i) {
+            if (((shorts>>i)&1) || (((longs>>i)&1) && matches(i))) {
+                return found(i);
+            }
+        }
+        if (m_options.size()<=small_size) return nullptr;
+    }
+
+    // follow edges until the name is unique, then compare it once
+    auto const by_long = [this,&str,n]() -> std::uint32_t {
+        std::uint32_t state = 0;
+        for (std::size_t i = 0; i<n; ++i) {
+            auto const first = m_edges[state], last = m_edges[state+1];
+            if (first==last) break;
+            auto const edge = static_cast<char const*>(
+                std::memchr(&m_label[first], str[i], last-first));
+            if (!edge) return 0;
+            state = m_next[static_cast<std::size_t>(edge-m_label.data())];
+        }
+        auto const id = m_accept[state];
+        return (id && m_options[id-1].longopt==str) ? id : 0;
+    };
+
+    // ids are the option index plus one, so the lower of two is the first
+    auto id = by_long();
+    if (n==1 && c!='\0') {
+        auto const s = m_by_short[static_cast<unsigned char>(c)];
+        if (s && (!id || s<id)) id = s;
+    }
+    return id ? found(id-1) : nullptr;
+}
+
+inline auto getoptxx::v1::arguments::parse(int argc, char* const argv[],
+    std::initializer_list<option> options) -> arguments {
+    return parse(argc, argv, options, arguments{});
+}
+
+inline auto getoptxx::v1::arguments::parse(int argc, char* const argv[],
+    std::initializer_list<option> options, arguments&& reuse) -> arguments {
+    arguments args{ std::move(reuse) };
+    args.clear();
+    try {
+        do_parse(args, argc, argv, options);
+    } catch (...) { // hand the storage back so it survives a bad command line
+        reuse = std::move(args);
+        throw;
+    }
+    return args;
+}
+
+inline auto getoptxx::v1::arguments::parse(int argc, char* const argv[],
+    schema const& options) -> arguments {
+    return parse(argc, argv, options, arguments{});
+}
+
+inline auto getoptxx::v1::arguments::parse(int argc, char* const argv[],
+    schema const& options, arguments&& reuse) -> arguments {
+    arguments args{ std::move(reuse) };
+    args.clear();
+    try {
+        do_parse(args, argc, argv, options);
+    } catch (...) { // hand the storage back so it survives a bad command line
+        reuse = std::move(args);
+        throw;
+    }
+    return args;
+}
+
+inline auto getoptxx::v1::arguments::parse_query(char* query,
+    std::initializer_list<option> options) -> arguments {
+    arguments args;
+    do_parse_query(args, query, options);
+    return args;
+}
+
+inline auto getoptxx::v1::arguments::parse_query(char* query,
+    schema const& options) -> arguments {
+    arguments args;
+    do_parse_query(args, query, options);
+    return args;
+}
+
+inline auto getoptxx::v1::arguments::parse_json(char* json, std::size_t size,
+    std::initializer_list<option> options) -> arguments {
+    arguments args;
+    do_parse_json(args, json, size, options);
+    return args;
+}
+
+inline auto getoptxx::v1::arguments::parse_json(char* json, std::size_t size,
+    schema const& options) -> arguments {
+    arguments args;
+    do_parse_json(args, json, size, options);
+    return args;
+}
+
+template <class Options>
+void getoptxx::v1::arguments::do_parse(arguments& args, int argc,
+    char* const argv[], Options const& options) {
+    if (argc<1) { // nothing to parse, but required options are still missing
+        args.check_required(options);
+        return;
+    }
+
+    // single pass: "--" is found by the loop rather than a separate scan,
+    // and the unparsed list is sized once for the worst case
+    auto const argend = argv+argc;
+    args.m_unparsed.reserve(args.m_unparsed.size()+argc-1);
+
+    auto arg = argv+1;
+    for (; arg!=argend; ++arg) {
+        if (!*arg) continue; // ignore empty arguments
+
+        if ((*arg)[0] != '-') { // non-option arguments
+            args.m_unparsed.push_back(*arg);
+            continue;
+        } else if (!(*arg)[1]) { // ignore a single '-'
+            continue;
+        } else if ((*arg)[1]=='-' && !(*arg)[2]) { // "--" ends the options
+            break;
+        }
+
+        // can now assume: a[0]=='-' && a.size()>1
+        key_type const str{ ((*arg)[1]=='-') ? &(*arg)[2] : &(*arg)[1] };
+        args.m_help = (str=="h" || str=="help");
+        if (args.m_help) return;
+
+        auto const opt = find(options, str);
+
+        auto const val = [&str,aflags=opt->aflags,&arg,&argend]()->value_type {
+            bool const present =
+                (arg+1<argend && *(arg+1) && (*(arg+1))[0]!='-');
+            if (aflags==option::argument_flags::none) return {};
+            if (aflags==option::argument_flags::required && !present) {
+                throw std::runtime_error{
+                    "option '"+str.to_string()+"' requires a value" };
+            }
+            if (present) return *(++arg);
+            else return {};
+        }();
+
+        args.store(*opt, val);
+    }
+
+    args.check_required(options);
+
+    if (arg!=argend) {
+        std::copy_if(arg+1, argend, std::back_inserter(args.m_unparsed),
+                     [](char const* a) { return a!=nullptr; });
+    }
+}
+
+template <class Options>
+void getoptxx::v1::arguments::do_parse_query(arguments& args, char* query,
+    Options const& options) {
+    if (!query) { // nothing to parse, but required options are still missing
+        args.check_required(options);
+        return;
+    }
+
+    // decode [first,last) into first, NUL-terminating the result; the
+    // decoded form is never longer so the write position never passes read
+    auto const decode = [](char* first, char* last) -> value_type {
+        auto const hex = [](char c) -> int {
+            if (c>='0' && c<='9') return c-'0';
+            if (c>='a' && c<='f') return c-'a'+10;
+            if (c>='A' && c<='F') return c-'A'+10;
+            return -1;
+        };
+
+        auto out = first;
+        for (auto in = first; in!=last; ++in, ++out) {
+            if (*in=='+') {
+                *out = ' ';
+            } else if (*in=='%') {
+                int const hi = (last-in>2) ? hex(in[1]) : -1;
+                int const lo = (hi>=0) ? hex(in[2]) : -1;
+                if (lo<0) throw std::runtime_error{ "invalid percent-encoding" };
+                *out = static_cast<char>(hi*16+lo);
+                in += 2;
+            } else {
+                *out = *in;
+            }
+        }
+        *out = '\0';
+        return { first, static_cast<std::size_t>(out-first) };
+    };
+
+    auto pos = query + (query[0]=='?' ? 1 : 0);
+    auto const qend = pos + std::char_traits<char>::length(pos);
+
+    while (pos!=qend) {
+        auto const amp = std::find(pos, qend, '&');
+        auto const eq = std::find(pos, amp, '=');
+        auto const next = (amp==qend) ? amp : amp+1;
+
+        if (pos==amp) { // ignore empty pairs
+            pos = next;
+            continue;
+        }
+
+        auto const str = decode(pos, eq);
+        args.m_help = (str=="h" || str=="help");
+        if (args.m_help) return;
+
+        auto const opt = find(options, str);
+        auto const val = (eq==amp) ? value_type{} : decode(eq+1, amp);
+
+        if (opt->aflags==option::argument_flags::none && eq!=amp) {
+            throw std::runtime_error{
+                "option '"+str.to_string()+"' does not take a value" };
+        }
+        if (opt->aflags==option::argument_flags::required && val.empty()) {
+            throw std::runtime_error{
+                "option '"+str.to_string()+"' requires a value" };
+        }
+
+        args.store(*opt, val);
+        pos = next;
+    }
+
+    args.check_required(options);
+}
+
+template <class Options>
+void getoptxx::v1::arguments::do_parse_json(arguments& args, char* json,
+    std::size_t size, Options const& options) {
+    if (!json) { // nothing to parse, but required options are still missing
+        args.check_required(options);
+        return;
+    }
+
+    auto pos = json;
+    auto const last = json+size;
+    char held = '\0'; // a delimiter overwritten by a NUL terminator
+
+    auto const error = [](char const* what) {
+        throw std::runtime_error{ std::string{ "invalid JSON: " }+what };
+    };
+
+    auto const space = [](char c) {
+        return c==' ' || c=='\t' || c=='\n' || c=='\r';
+    };
+
+    auto const peek = [&]() -> char {
+        if (held) return held;
+        while (pos!=last && space(*pos)) ++pos;
+        return (pos!=last) ? *pos : '\0';
+    };
+
+    auto const take = [&]() {
+        if (held) held = '\0';
+        else ++pos;
+    };
+
+    // unescape the string at pos into place, NUL-terminating the result
+    // where the closing quote was
+    auto const string = [&]() -> value_type {
+        auto out = ++pos;
+        auto const first = out;
+
+        auto const hex4 = [&]() -> unsigned long {
+            if (last-pos<4) error("truncated \\u escape");
+            unsigned long cp = 0;
+            for (auto const end = pos+4; pos!=end; ++pos) {
+                auto const c = *pos;
+                cp <<= 4;
+                if (c>='0' && c<='9') cp |= c-'0';
+                else if (c>='a' && c<='f') cp |= c-'a'+10;
+                else if (c>='A' && c<='F') cp |= c-'A'+10;
+                else error("invalid \\u escape");
+            }
+            return cp;
+        };
+
+        for (;;) {
+            if (pos==last) error("unterminated string");
+            auto c = *pos++;
+            if (c=='"') break;
+            if (c!='\\') {
+                *out++ = c;
+                continue;
+            }
+
+            if (pos==last) error("unterminated string");
+            switch (c = *pos++) {
+            case '"': case '\\': case '/': *out++ = c; break;
+            case 'b': *out++ = '\b'; break;
+            case 'f': *out++ = '\f'; break;
+            case 'n': *out++ = '\n'; break;
+            case 'r': *out++ = '\r'; break;
+            case 't': *out++ = '\t'; break;
+            case 'u': {
+                auto cp = hex4();
+                if (cp>=0xdc00 && cp<0xe000) error("unpaired surrogate");
+                if (cp>=0xd800 && cp<0xdc00) {
+                    if (last-pos<6 || pos[0]!='\\' || pos[1]!='u') {
+                        error("unpaired surrogate");
+                    }
+                    pos += 2;
+                    auto const lo = hex4();
+                    if (lo<0xdc00 || lo>=0xe000) error("unpaired surrogate");
+                    cp = 0x10000+((cp-0xd800)<<10)+(lo-0xdc00);
+                }
+
+                if (cp<0x80) {
+                    *out++ = static_cast<char>(cp);
+                } else if (cp<0x800) {
+                    *out++ = static_cast<char>(0xc0|(cp>>6));
+                    *out++ = static_cast<char>(0x80|(cp&0x3f));
+                } else if (cp<0x10000) {
+                    *out++ = static_cast<char>(0xe0|(cp>>12));
+                    *out++ = static_cast<char>(0x80|((cp>>6)&0x3f));
+                    *out++ = static_cast<char>(0x80|(cp&0x3f));
+                } else {
+                    *out++ = static_cast<char>(0xf0|(cp>>18));
+                    *out++ = static_cast<char>(0x80|((cp>>12)&0x3f));
+                    *out++ = static_cast<char>(0x80|((cp>>6)&0x3f));
+                    *out++ = static_cast<char>(0x80|(cp&0x3f));
+                }
+                break;
+            }
+            default: error("invalid escape");
+            }
+        }
+
+        *out = '\0';
+        return { first, static_cast<std::size_t>(out-first) };
+    };
+
+    // scan a number or true/false/null literal, NUL-terminating it in place
+    auto const literal = [&]() -> value_type {
+        auto const first = pos;
+        while (pos!=last && (std::isalnum(static_cast<unsigned char>(*pos))
+                             || *pos=='-' || *pos=='+' || *pos=='.')) ++pos;
+        if (pos==first) error("unexpected character");
+        if (pos==last) error("unterminated object");
+
+        if (*pos==',' || *pos=='}') held = *pos;
+        else if (!space(*pos)) error("unexpected character");
+        *pos++ = '\0';
+        return { first, static_cast<std::size_t>(pos-1-first) };
+    };
+
+    // true if the literal matches the JSON number grammar
+    auto const number = [](value_type val) {
+        auto const digits = [&val](std::size_t i) {
+            auto const start = i;
+            while (i<val.size() &&
+                   std::isdigit(static_cast<unsigned char>(val[i]))) ++i;
+            return (i==start) ? value_type::npos : i;
+        };
+
+        std::size_t i = (!val.empty() && val[0]=='-') ? 1 : 0;
+        if (i<val.size() && val[i]=='0') ++i;
+        else if ((i = digits(i))==value_type::npos) return false;
+        if (i<val.size() && val[i]=='.') {
+            if ((i = digits(i+1))==value_type::npos) return false;
+        }
+        if (i<val.size() && (val[i]=='e' || val[i]=='E')) {
+            ++i;
+            if (i<val.size() && (val[i]=='+' || val[i]=='-')) ++i;
+            if ((i = digits(i))==value_type::npos) return false;
+        }
+        return i==val.size();
+    };
+
+    if (peek()!='{') error("expected object");
+    take();
+
+    std::string path{}; // dotted path of the enclosing objects
+    // length of path before each enclosing object's name was appended, so
+    // closing an object is correct even when member names contain a '.'
+    std::vector<std::size_t> outer{};
+    bool first = true;
+
+    for (;;) {
+        auto c = peek();
+        if (c=='}') {
+            take();
+            first = false;
+            if (outer.empty()) break;
+            path.erase(outer.back());
+            outer.pop_back();
+            continue;
+        }
+
+        if (!first) {
+            if (c!=',') error("expected ',' or '}'");
+            take();
+            c = peek();
+        }
+        if (c!='"') error("expected member name");
+
+        auto const key = string();
+        if (peek()!=':') error("expected ':'");
+        take();
+
+        c = peek();
+        if (c=='{') {
+            take();
+            outer.push_back(path.size());
+            path.append(key.data(), key.size()).push_back('.');
+            first = true;
+            continue;
+        } else if (c=='[') {
+            error("arrays are not supported");
+        }
+        first = false;
+
+        auto const quoted = (c=='"');
+        auto const val = quoted ? string() : literal();
+        if (!quoted && val!="true" && val!="false" && val!="null" &&
+            !number(val)) {
+            error("unexpected literal");
+        }
+
+        auto const str = path.empty() ? key : [&path,&key]{
+            path.append(key.data(), key.size());
+            return key_type{ path };
+        }();
+        auto const opt = find(options, str);
+        if (!path.empty()) path.erase(path.size()-key.size());
+        if (!quoted && val=="null") continue;
+
+        if (opt->aflags==option::argument_flags::none) {
+            if (quoted || (val!="true" && val!="false")) {
+                throw std::runtime_error{
+                    "option '"+to_string(*opt)+"' does not take a value" };
+            }
+            if (val=="true") args.store(*opt, {});
+            continue;
+        }
+
+        if (opt->aflags==option::argument_flags::required && val.empty()) {
+            throw std::runtime_error{
+                "option '"+to_string(*opt)+"' requires a value" };
+        }
+        args.store(*opt, val);
+    }
+
+    held = '\0';
+    if (peek()!='\0' || pos!=last) error("trailing characters");
+
+    args.check_required(options);
+}
+
+template <class InputIt>
+auto getoptxx::v1::arguments::extract(InputIt first, InputIt last,
+    std::uint64_t* present, value_type* values) const -> std::size_t {
+    std::size_t i = 0, found = 0;
+    std::uint64_t bits = 0;
+
+    // the bitmap is written a word at a time rather than bit by bit
+    for (; first!=last; ++first, ++i) {
+        auto const e = lookup(hash_of(*first), name_of(*first));
+        values[i] = e ? e->value : value_type{};
+        bits |= std::uint64_t{ e!=nullptr }<<(i%64);
+        found += (e!=nullptr);
+        if (i%64==63) {
+            present[i/64] = bits;
+            bits = 0;
+        }
+    }
+    if (i%64) present[i/64] = bits;
+    return found;
+}
+
+inline void getoptxx::v1::arguments::publish(arguments args) {
+    // never destroyed, so published() stays valid in static destructors and
+    // in threads still running at exit
+    struct registry {
+        std::mutex mutex{};
+        std::vector<std::unique_ptr<arguments const>> all{};
+    };
+    static auto const instances = new registry{};
+
+    std::lock_guard<std::mutex> lock{ instances->mutex };
+    instances->all.emplace_back(new arguments(std::move(args)));
+    current().store(instances->all.back().get(), std::memory_order_release);
+}
+
+template <class OutputIt>
+OutputIt getoptxx::v1::arguments::write_json(OutputIt out) const {
+    auto const put = [&out](key_type const& str) {
+        out = std::copy(std::begin(str), std::end(str), out);
+    };
+
+    auto const quote = [&out](value_type const& str) {
+        static char const digits[] = "0123456789abcdef";
+        *out++ = '"';
+        for (auto&& c : str) {
+            auto const u = static_cast<unsigned char>(c);
+            if (c=='"' || c=='\\') {
+                *out++ = '\\';
+                *out++ = c;
+            } else if (u<0x20) {
+                char const esc[] = { '\\', 'u', '0', '0',
+                                     digits[u>>4], digits[u&0xf] };
+                out = std::copy(std::begin(esc), std::end(esc), out);
+            } else {
+                *out++ = c;
+            }
+        }
+        *out++ = '"';
+    };
+
+    put(m_help ? "{\"help\":true,\"options\":{" : "{\"help\":false,\"options\":{");
+    bool first = true;
+    for (auto&& e : m_parsed) {
+        if (e.key.empty()) continue;
+        if (!first) *out++ = ',';
+        first = false;
+        quote(e.key);
+        *out++ = ':';
+        quote(e.value);
+    }
+
+    put("},\"unparsed\":[");
+    first = true;
+    for (auto&& arg : m_unparsed) {
+        if (!first) *out++ = ',';
+        first = false;
+        quote(arg);
+    }
+    put("]}");
+    return out;
+}
+
+inline auto getoptxx::v1::arguments::find(
+    std::initializer_list<option> options, key_type const& str)
+    -> option const* {
+    auto const opt = std::find_if(std::begin(options), std::end(options),
+        [&str](auto&& o) { return str==o.shortopt || str==o.longopt; });
+    if (str.empty() || opt==std::end(options)) {
+        throw std::runtime_error{ "unknown option '"+str.to_string()+"'" };
+    }
+    return opt;
+}
+
+inline auto getoptxx::v1::arguments::find(schema const& options,
+    key_type const& str) -> option const* {
+    auto const opt = options.find(str);
+    if (!opt) {
+        throw std::runtime_error{ "unknown option '"+str.to_string()+"'" };
+    }
+    return opt;
+}
+
+inline void getoptxx::v1::arguments::store(option const& opt,
+                                           value_type const& val) {
+    if (!opt.shortopt.empty()) insert(opt.shortopt, val);
+    if (!opt.longopt.empty()) insert(opt.longopt, val);
+}
+
+inline void getoptxx::v1::arguments::insert(key_type const& key,
+                                            value_type const& val) {
+    // keep the table at most half full so probe sequences stay short
+    if ((m_size+1)*2>m_parsed.size()) {
+        std::vector<entry> table(std::max<std::size_t>(16, m_parsed.size()*2));
+        auto const mask = table.size()-1;
+        for (auto&& e : m_parsed) {
+            if (e.key.empty()) continue;
+            auto i = static_cast<std::size_t>(e.hash)&mask;
+            while (!table[i].key.empty()) i = (i+1)&mask;
+            table[i] = e;
+        }
+        m_parsed.swap(table);
+    }
+
+    auto const hash = option_key::hash(key.data(), key.size());
+    auto const mask = m_parsed.size()-1;
+    auto i = static_cast<std::size_t>(hash)&mask;
+    for (; !m_parsed[i].key.empty(); i = (i+1)&mask) {
+        if (m_parsed[i].hash==hash && m_parsed[i].key==key) return;
+    }
+    m_parsed[i] = { hash, key, val };
+    ++m_size;
+}
+
+inline void getoptxx::v1::arguments::check_required(
+    std::initializer_list<option> options) const {
+    std::for_each(std::begin(options), std::end(options), [this](auto&& o) {
+        if (o.oflags != option::option_flags::required) return;
+
+        if ((!o.shortopt.empty() && !exists(o.shortopt))||
+            (!o.longopt.empty() && !exists(o.longopt))) {
+            throw std::runtime_error{ "option '"+to_string(o)+"' required" };
+        }
+    });
+}
+
+inline void getoptxx::v1::arguments::check_required(
+    schema const& options) const {
+    options.each_required([this](option const& o) {
+        if ((!o.shortopt.empty() && !exists(o.shortopt))||
+            (!o.longopt.empty() && !exists(o.longopt))) {
+            throw std::runtime_error{ "option '"+to_string(o)+"' required" };
+        }
+    });
+}
+
+inline auto getoptxx::v1::arguments::parse_line(char* line,
+    schema const& options, limits const& budget) -> arguments {
+    parser p{ options, budget };
+    if (!line) return p.finish();
+
+    auto const space = [](char c) {
+        return c==' ' || c=='\t' || c=='\n' || c=='\r';
+    };
+
+    // checked per byte so an oversized line is rejected without reading
+    // more of it than the budget allows
+    auto in = line;
+    auto const check = [&in,line,&budget]() {
+        if (static_cast<std::size_t>(in-line)>=budget.bytes) {
+            throw std::runtime_error{ "command line too long" };
+        }
+    };
+
+    // a backslash-newline is removed, joining the lines around it
+    auto const continuation = [](char const* c) {
+        return c[0]=='\\' && c[1]=='\n';
+    };
+    auto const escaped = [](char c) {
+        return c=='$' || c=='`' || c=='"' || c=='\\' || c=='\n';
+    };
+
+    bool program = true;
+    std::size_t tokens = 0;
+    for (;;) {
+        for (; space(*in) || continuation(in); ++in) {
+            check();
+            if (*in=='\\') {
+                ++in;
+                check();
+            }
+        }
+        if (!*in) break;
+        if (++tokens>budget.tokens) {
+            throw std::runtime_error{ "too many arguments" };
+        }
+
+        // unquote [in,...) into out; the unquoted token is never longer
+        auto const first = in;
+        auto out = in;
+        char quote = '\0';
+        for (; *in && (quote || !space(*in)); ++in) {
+            check();
+            if (quote=='\'') {
+                if (*in=='\'') quote = '\0';
+                else *out++ = *in;
+            } else if (*in=='\\' && (!quote || escaped(in[1]))) {
+                if (!in[1]) throw std::runtime_error{ "trailing backslash" };
+                ++in;
+                check();
+                if (*in!='\n') *out++ = *in;
+            } else if (*in=='"' || (!quote && *in=='\'')) {
+                quote = (quote==*in) ? '\0' : *in;
+            } else {
+                *out++ = *in;
+            }
+        }
+        if (quote) throw std::runtime_error{ "unterminated quote" };
+
+        auto const more = (*in!='\0');
+        *out = '\0';
+        if (!program) p.push({ first, static_cast<std::size_t>(out-first) });
+        program = false;
+        if (!more) break;
+        ++in;
+    }
+
+    return p.finish();
+}
+
+template <std::size_t N>
+auto getoptxx::v1::arguments::parse(int argc, char* const argv[],
+    schema const& options, command_line<N> const& defaults) -> arguments {
+    // options keep their first value, so argv is parsed before the defaults
+    parser p{ options };
+    for (int i = 1; i<argc; ++i) {
+        if (argv[i]) p.push(argv[i]);
+    }
+    if (p.m_pending && !p.m_args.help()) p.resolve();
+    p.m_ended = false;
+
+    for (std::size_t i = 0; i<defaults.size(); ++i) p.push(defaults[i]);
+    return p.finish();
+}
+
+inline void getoptxx::v1::parser::push(value_type const& token) {
+    if (m_args.help()) return;
+
+    if (++m_tokens>m_limits.tokens) {
+        throw std::runtime_error{ "too many arguments" };
+    }
+    if ((m_bytes += token.size())>m_limits.bytes) {
+        throw std::runtime_error{ "command line too long" };
+    }
+
+    if (m_ended) { // everything after "--" is unparsed
+        m_args.m_unparsed.push_back(token);
+        return;
+    }
+
+    if (m_pending) {
+        if (token.empty() || token[0]!='-') {
+            store(*m_pending, token);
+            m_pending = nullptr;
+            return;
+        }
+        resolve();
+    }
+
+    if (token.empty() || token[0]!='-') { // non-option arguments
+        m_args.m_unparsed.push_back(token);
+        return;
+    } else if (token.size()==1) { // ignore a single '-'
+        return;
+    } else if (token=="--") {
+        m_ended = true;
+        return;
+    }
+
+    auto const str = token.substr((token[1]=='-') ? 2 : 1);
+    m_args.m_help = (str=="h" || str=="help");
+    if (m_args.m_help) return;
+
+    auto const opt = arguments::find(*m_schema, str);
+    if (opt->aflags==option::argument_flags::none) store(*opt, {});
+    else m_pending = opt;
+}
+
+inline auto getoptxx::v1::parser::finish() -> arguments {
+    if (m_pending && !m_args.help()) resolve();
+    if (!m_args.help()) m_args.check_required(*m_schema);
+    return m_args;
+}
+
+inline void getoptxx::v1::parser::resolve() {
+    auto const opt = m_pending;
+    if (opt->aflags==option::argument_flags::required) {
+        throw std::runtime_error{
+            "option '"+to_string(*opt)+"' requires a value" };
+    }
+    m_pending = nullptr;
+    store(*opt, {});
+}
+
+inline void getoptxx::v1::parser::store(option const& opt,
+                                        value_type const& val) {
+    // counted by the option found, since a shadowed option may share names
+    if (opt.oflags==option::option_flags::required) {
+        auto const i = m_schema->required_index(opt);
+        if (i!=SIZE_MAX) {
+            if (m_seen.size()<=i) m_seen.resize(m_schema->required_count());
+            if (!m_seen[i]) {
+                m_seen[i] = true;
+                ++m_required;
+            }
+        }
+    }
+    m_args.store(opt, val);
 }
 
 #endif // !defined(GUARD_GETOPTXX_H)
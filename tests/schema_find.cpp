@@ -0,0 +1,77 @@
+// Differential test of getoptxx::schema::find against the reference scan
+// used by arguments::parse for a std::initializer_list of options.
+//
+//   c++ -std=c++14 -I.. schema_find.cpp -o schema_find && ./schema_find
+//
+// Exits with a non-zero status and prints the first divergences if any
+// lookup resolves to a different option than the reference.
+
+#include "getoptxx.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace go = getoptxx;
+
+namespace {
+
+auto reference(std::vector<go::option> const& options,
+               go::schema::key_type const& str) -> go::option const* {
+    auto const opt = std::find_if(std::begin(options), std::end(options),
+        [&str](auto&& o) { return str==o.shortopt || str==o.longopt; });
+    return (str.empty() || opt==std::end(options)) ? nullptr : &*opt;
+}
+
+auto random_name(std::mt19937& rng, char const* alphabet,
+                 std::size_t size) -> std::string {
+    std::string name(1+rng()%6, '\0');
+    for (auto&& c : name) c = alphabet[rng()%size];
+    return name;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng{ 1 };
+    std::size_t lookups = 0, bad = 0;
+
+    // small alphabets give many shared prefixes, duplicate names and one
+    // character long names; sizes cover both sides of the 32 option table
+    for (int round = 0; round<300; ++round) {
+        std::vector<std::string> names(1+rng()%200);
+        for (auto&& name : names) {
+            name = random_name(rng, "abc-x", 5);
+            if (rng()%3==0) name = std::string(1, "abpq"[rng()%4])+","+name;
+        }
+
+        std::vector<go::option> options{};
+        for (auto&& name : names) {
+            options.emplace_back(go::schema::key_type{ name });
+        }
+        go::schema const compiled(std::begin(options), std::end(options));
+
+        for (int query = 0; query<300; ++query) {
+            auto const str = (rng()%3==0)
+                ? std::string(1, "abcpqxz"[rng()%7])
+                : random_name(rng, "abc-xpqz", 8);
+            go::schema::key_type const key{ str };
+
+            // compare positions, since equal names may be different options
+            auto const want = reference(options, key);
+            auto const got = compiled.find(key);
+            auto const want_at = want ? want-&options[0] : -1;
+            auto const got_at = got ? got-&*std::begin(compiled) : -1;
+            ++lookups;
+            if (want_at!=got_at && ++bad<=10) {
+                std::printf("round %d: '%s' resolved to option %td, "
+                    "expected %td\n", round, str.c_str(), got_at, want_at);
+            }
+        }
+    }
+
+    std::printf("%zu lookups, %zu divergences\n", lookups, bad);
+    return bad ? EXIT_FAILURE : EXIT_SUCCESS;
+}